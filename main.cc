@@ -1,31 +1,69 @@
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <iostream>
+#include <filesystem>
 #include <fstream>
 #include <stdio.h>
+#include <omp.h>
 
 #include "src/environment/flappy_simulator.h"
 #include "src/learner/sarsa.h"
+#include "src/learner/true_online_sarsa.h"
+#include "src/learner/static_sarsa.h"
+#include "src/learner/fitted_q.h"
 #include "src/policy/epsilon_greedy.h"
+#include "src/policy/fixed_epsilon_greedy.h"
 #include "src/approximator/tile_coding.h"
+#include "src/approximator/fixed_tile_coding.h"
+#include "src/approximator/incremental_checkpoint.h"
+#include "src/approximator/quantized_tile_coding.h"
+#include "src/evaluation/async_evaluator.h"
+#include "src/evaluation/evaluation.h"
+#include "src/render/frame_renderer.h"
+#ifdef RLAGENT_WITH_SDL
+#include "src/render/sdl_renderer.h"
+#endif
 
 #include "utils.h"
 
+/**
+ * @brief Reward of the Flappy Bird setup, penalizes collisions
+ */
+struct FlappyReward {
+  template <class State>
+  double operator()(const State& x, int a, const State& x_next, const FlappySimulator& env) const {
+    return env.getCollision() ? -100.0 : 1.0;
+  }
+};
+
 void learn_batch(Learner* learner, int batch_size, int episode_length,
   std::vector<double>& msve_batch, std::vector<double>& reward_batch);
 
 void save_statistics(std::string filename, const double* msve_array,
   const double* reward_array, int number_of_episodes);
 
+void save_evaluations(std::string filename,
+  const std::vector<EvaluationResult>& evaluations);
+
+void save_distributions(std::string filename, int number_of_episodes,
+  const Distribution& length, const Distribution& reward);
+
 int main(int argc, char** argv) {
   // Parse command line arguments
   const char* execution_mode = get_cmd_option(
     argv, argv+argc, "-exec");
   bool mode_learn = false;
   bool mode_play = false;
+  bool mode_eval = false;
+  bool mode_record = false;
+  bool mode_offline = false;
   if (execution_mode) {
     mode_learn = std::string(execution_mode) == "learn";
     mode_play = std::string(execution_mode) == "play";
+    mode_eval = std::string(execution_mode) == "eval";
+    mode_record = std::string(execution_mode) == "record";
+    mode_offline = std::string(execution_mode) == "offline";
   }
 
   const char* working_directory = get_cmd_option(
@@ -34,8 +72,8 @@ int main(int argc, char** argv) {
     working_directory = "./";
   }
 
-  // Initialize environment
-  FlappySimulator env(true);
+  // Initialize environment, windows are opened by the renderer
+  FlappySimulator env;
 
   // Create value function approximator
   const double learning_rate = 1e-1;
@@ -48,49 +86,247 @@ int main(int argc, char** argv) {
     << 0, 3.75, 3.75, 1, -10).finished();
   auto state_space_max = (Eigen::Matrix<float, 5, 1>()
     << 11, 10.25, 10.25, 13, 10).finished();
-  auto approximator = std::make_shared<TileCoding>(
-                env.getNumberOfActions(),
-                env.getStateDim(),
-                learning_rate,
-                tilings,
-                displacement,
-                state_space_segments,
-                state_space_min,
-                state_space_max);
-  
-  // Create policy
+  // Optionally keep the weights in a memory-mapped file
+  std::string weight_file;
+  const bool mode_mmap = cmd_option_exists(argv, argv+argc, "-mmap");
+  if (mode_mmap) {
+    weight_file = std::string(working_directory) + "/approximator.map";
+  }
+  // Create approximator and policy
   double epsilon = 0.2;
   double epsilon_decay = 1.0 - 3e-6;
-  auto policy = std::make_shared<EpsilonGreedy>(epsilon, approximator);
+  std::shared_ptr<Approximator> approximator;
+  std::shared_ptr<EpsilonGreedy> policy;
+  // Sizes known at compile time select the specialized tile coding
+  typedef FixedTileCoding<FlappySimulator::SIZE_OF_STATESPACE,
+    FlappySimulator::NUMBER_OF_ACTIONS, tilings> FlappyTileCoding;
+  typedef FixedEpsilonGreedy<FlappyTileCoding> FlappyPolicy;
+  std::shared_ptr<FlappyTileCoding> fixed_approximator;
+  std::shared_ptr<FlappyPolicy> fixed_policy;
+  const bool mode_fixed = cmd_option_exists(argv, argv+argc, "-fixed");
+  // Also creates the replica of the asynchronous evaluation
+  auto make_approximator = [&](const std::string& file) -> std::shared_ptr<Approximator> {
+    if (mode_fixed) {
+      return std::make_shared<FlappyTileCoding>(
+                  learning_rate,
+                  displacement,
+                  state_space_segments,
+                  state_space_min,
+                  state_space_max,
+                  0.0, 0.0,
+                  file);
+    }
+    return std::make_shared<TileCoding>(
+                  env.getNumberOfActions(),
+                  env.getStateDim(),
+                  learning_rate,
+                  tilings,
+                  displacement,
+                  state_space_segments,
+                  state_space_min,
+                  state_space_max,
+                  (Eigen::Matrix<float, 1, 1>() << 1.0).finished(),
+                  0.0, 0.0,
+                  file);
+  };
+  approximator = make_approximator(weight_file);
+  if (mode_fixed) {
+    fixed_approximator = std::static_pointer_cast<FlappyTileCoding>(approximator);
+    fixed_policy = std::make_shared<FlappyPolicy>(epsilon, fixed_approximator);
+    policy = fixed_policy;
+  } else {
+    policy = std::make_shared<EpsilonGreedy>(epsilon, approximator);
+  }
+  
+  // Select how learner threads synchronize on the approximator
+  const char* concurrency = get_cmd_option(argv, argv+argc, "-concurrency");
+  if (concurrency) {
+    std::string mode(concurrency);
+    if (mode == "hogwild") {
+      approximator->concurrency_mode = ConcurrencyMode::HOGWILD;
+    } else if (mode == "atomic") {
+      approximator->concurrency_mode = ConcurrencyMode::ATOMIC;
+    } else if (mode == "buffered") {
+      approximator->concurrency_mode = ConcurrencyMode::BUFFERED;
+    } else if (mode != "locked") {
+      std::cout << "Unknown concurrency mode: " << mode << std::endl;
+      return 1;
+    }
+  }
+  
+  // Place the weights on the NUMA nodes of the machine
+  const char* numa = get_cmd_option(argv, argv+argc, "-numa");
+  if (numa) {
+    std::string placement(numa);
+    WeightTable* weights = approximator->weight_table();
+    const char* numa_node = get_cmd_option(argv, argv+argc, "-node");
+    if (placement == "local") {
+      weights->place(MemoryPlacement::FIRST_TOUCH);
+    } else if (placement == "interleave") {
+      weights->place(MemoryPlacement::INTERLEAVE);
+    } else if (placement == "bind") {
+      weights->place(MemoryPlacement::BIND, numa_node ? std::atoi(numa_node) : 0);
+    } else if (placement == "replicate") {
+      weights->place(MemoryPlacement::INTERLEAVE);
+      weights->replicate(true);
+      // The node of a thread is looked up once, unpinned threads may read remote replicas
+      if (omp_get_proc_bind() == omp_proc_bind_false)
+        std::cout << "Warning: threads are not pinned, set OMP_PROC_BIND=spread" << std::endl;
+    } else {
+      std::cout << "Unknown NUMA placement: " << placement << std::endl;
+      return 1;
+    }
+    std::cout << "NUMA nodes: " << WeightTable::numa_nodes() << std::endl;
+  }
 
+  const char* merge_interval = get_cmd_option(argv, argv+argc, "-merge");
+  if (merge_interval) {
+    approximator->merge_interval = std::max(1, std::atoi(merge_interval));
+  }
+  
   // Create learner
   const int number_of_episodes = 1e6;
-  Learner::reward_function reward = [](Eigen::VectorXd x, int a, Eigen::VectorXd x_next, Environment* env) {
-      auto* flappy_env = (FlappySimulator*)env;
-      return flappy_env->getCollision() ? -100.0 : 1.0;
+  Learner::reward_function reward = [](const Eigen::Ref<const Eigen::VectorXd>& x, int a,
+      const Eigen::Ref<const Eigen::VectorXd>& x_next, Environment* env) {
+      return FlappyReward()(x, a, x_next, *(FlappySimulator*)env);
   };
   Learner::environment_function init_env = []() {
     auto env = std::make_shared<FlappySimulator>();
     return env;
   };
   const double discount = 0.9;
-  Sarsa learner(discount, policy, approximator, reward, init_env, 20);
+  std::shared_ptr<Learner> learner;
+  const char* lambda = get_cmd_option(argv, argv+argc, "-lambda");
+  const char* replay = get_cmd_option(argv, argv+argc, "-replay");
+  if (lambda && replay) {
+    std::cout << "Replay is not supported with -lambda" << std::endl;
+    return 1;
+  }
+  if (lambda) {
+    // Eligibility traces replace the n-step window
+    learner = std::make_shared<TrueOnlineSarsa>(
+      discount, policy, approximator, reward, init_env, std::atof(lambda));
+  } else if (fixed_policy && !replay) {
+    // The fixed configuration is composed at compile time
+    learner = std::make_shared<StaticSarsa<FlappySimulator, FlappyPolicy,
+      FlappyTileCoding, FlappyReward, 20>>(
+      discount, fixed_policy, fixed_approximator, FlappyReward(), init_env);
+  } else {
+    if (fixed_policy) {
+      std::cout << "Replay needs the runtime Sarsa, -fixed only selects the tile coding" << std::endl;
+    }
+    auto sarsa = std::make_shared<Sarsa>(discount, policy, approximator, reward, init_env, 20);
+    // Prioritized replay of the last transitions between the online updates
+    if (replay) {
+      sarsa->replay = std::make_shared<ReplayBuffer>(std::atoi(replay), env.getStateDim());
+    }
+    learner = sarsa;
+  }
+  // A fixed seed reproduces the episodes of the environments
+  const char* seed = get_cmd_option(argv, argv+argc, "-seed");
+  if (seed) {
+    learner->run_seed = std::strtoull(seed, nullptr, 10);
+  }
 
-  if (mode_play) {
-    // Load pretrained approximator
-    approximator->load(std::string(working_directory) + "/approximator.dat");
+  if (mode_play || mode_eval || mode_record) {
+    // Map pretrained approximator in place (a mapped weight file is already loaded)
+    if (!mode_mmap) {
+      approximator->map(std::string(working_directory) + "/approximator.dat");
+      IncrementalCheckpoint::restore(
+        *approximator, std::string(working_directory) + "/approximator.dat");
+    }
     
+    // Optionally play with quantized weights
+    const char* quantize = get_cmd_option(argv, argv+argc, "-quantize");
+    auto tile_coding = std::dynamic_pointer_cast<TileCoding>(approximator);
+    if (quantize && tile_coding) {
+      auto precision = std::string(quantize) == "fp16" ?
+        QuantizedTileCoding::Precision::FP16 : QuantizedTileCoding::Precision::INT8;
+      auto quantized = std::make_shared<QuantizedTileCoding>(*tile_coding, precision);
+      // Compare greedy actions on random states of the state space
+      Eigen::MatrixXd states = (Eigen::MatrixXd::Random(env.getStateDim(), 10000).array() + 1.0) / 2.0;
+      for (int i=0; i < states.cols(); i++) {
+        states.col(i) = state_space_min.cast<double>().array()
+          + states.col(i).array() * (state_space_max - state_space_min).cast<double>().array();
+      }
+      std::cout << "quantized weights: " << quantized->getMemorySize() << " bytes" << std::endl
+                << "greedy agreement: " << quantized->greedy_agreement(*approximator, states) << std::endl;
+      approximator = quantized;
+      policy = std::make_shared<EpsilonGreedy>(policy->epsilon, approximator);
+    } else if (quantize) {
+      std::cout << "Quantization needs the TileCoding approximator" << std::endl;
+      return 1;
+    }
+  }
+
+  if (mode_play || mode_record) {
     // Perform epsilon decay process
     policy->epsilon = policy->epsilon * std::pow(epsilon_decay, number_of_episodes);
+  }
 
+  if (mode_play) {
+#ifdef RLAGENT_WITH_SDL
     // Play for 5 minutes
-    env.play(policy, 300.0);
+    SdlRenderer window(
+      FlappySimulator::screen_width * FlappySimulator::screen_scale,
+      FlappySimulator::screen_height * FlappySimulator::screen_scale);
+    window.play(env, policy, 300.0);
+#else
+    std::cout << "Built without SDL, use -exec record" << std::endl;
+    return 1;
+#endif
+  }
+
+  if (mode_record) {
+    // Frames are written as fast as the simulation runs
+    const char* frames = get_cmd_option(argv, argv+argc, "-frames");
+    const char* format = get_cmd_option(argv, argv+argc, "-format");
+    const std::string frame_directory = std::string(working_directory) + "/frames";
+    std::filesystem::create_directories(frame_directory);
+    FrameRenderer recorder(frame_directory,
+      format && std::string(format) == "raw" ?
+        FrameRenderer::Format::RAW : FrameRenderer::Format::PPM);
+    if (seed) env.seed(learner->run_seed, 0);
+    int episodes = recorder.record(env, policy, frames ? std::atoi(frames) : 1000);
+    std::cout << "frames: " << recorder.getFrames() << std::endl
+              << "finished episodes: " << episodes << std::endl
+              << "Write into directory: " << frame_directory << std::endl;
+  }
+
+  if (mode_eval) {
+    // Greedy episodes on all cores, the same seed gives the same score
+    const char* episodes = get_cmd_option(argv, argv+argc, "-episodes");
+    const char* steps = get_cmd_option(argv, argv+argc, "-steps");
+    Evaluation evaluation = Evaluation::play(*approximator, init_env, reward,
+      episodes ? std::atoi(episodes) : 1000,
+      steps ? std::atoi(steps) : 10000,
+      seed ? learner->run_seed : 1);
+    save_distributions(std::string(working_directory) + "/evaluation_summary.csv",
+      int(evaluation.rewards.size()),
+      evaluation.length_distribution(), evaluation.reward_distribution());
   }
 
   if (mode_learn) {
     // Learning phase
     const int episode_length = 400;
-    learner.verbose = true;
+    learner->verbose = true;
+    // Optionally keep the experience, one file per thread
+    if (cmd_option_exists(argv, argv+argc, "-trajectory")) {
+      learner->recorder = std::make_shared<TrajectoryRecorder>(
+        std::string(working_directory) + "/trajectory", env.getStateDim());
+    }
+    // Checkpoints are written in the background, mostly as small deltas
+    IncrementalCheckpoint checkpoint(
+      approximator, std::string(working_directory) + "/approximator.dat");
+    // Example games are evaluated in the background on a snapshot, which
+    // costs two copies of the table in RAM (too much for mapped tables)
+    std::unique_ptr<AsyncEvaluator> evaluator;
+    if (!approximator->weight_table()->isMapped()) {
+      evaluator.reset(new AsyncEvaluator(
+        approximator, [&]() { return make_approximator(""); }, init_env, reward));
+    } else {
+      std::cout << "No evaluation while learning with -mmap, use -exec eval" << std::endl;
+    }
     
     // This could take a while ...
     const int number_of_batches = 100;
@@ -103,21 +339,59 @@ int main(int argc, char** argv) {
         std::ceil(double(number_of_episodes) / number_of_batches), 
         double(remaining_episodes));
       std::vector<double> msve_batch, reward_batch;
-      learn_batch(&learner, batch_size, episode_length, msve_batch, reward_batch);      
+      learn_batch(learner.get(), batch_size, episode_length, msve_batch, reward_batch);      
       // Save parameters
-      approximator->save(std::string(working_directory) + "/approximator.dat");
+      checkpoint.save();
       // Save statistics
       save_statistics(std::string(working_directory) + "/statistics.csv",
         msve_batch.data(), reward_batch.data(), batch_size);
-      // Play one example game
-      env.play(policy, 10.0);
+      // Evaluate the greedy policy while the next batch is learned
+      if (evaluator) {
+        evaluator->submit(current_batch);
+        save_evaluations(std::string(working_directory) + "/evaluation.csv",
+          evaluator->take_results());
+      }
       // Decay process of epsilon
       policy->epsilon = policy->epsilon * std::pow(epsilon_decay, batch_size);
       // Next batch ...
       remaining_episodes -= batch_size;  
     }    
+    // Leave a complete base behind, a mapped table is also written back
+    checkpoint.compact();
+    checkpoint.wait();
+    if (evaluator) {
+      evaluator->wait();
+      save_evaluations(std::string(working_directory) + "/evaluation.csv",
+        evaluator->take_results());
+    }
   }
   
+  if (mode_offline) {
+    // Retrain from the recorded trajectories of the working directory
+    FittedQ fitted_q(discount, approximator);
+    fitted_q.verbose = true;
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(working_directory)) {
+      const std::string name = entry.path().filename().string();
+      if (name.rfind("trajectory_", 0) == 0 && entry.path().extension() == ".traj")
+        files.push_back(entry.path().string());
+    }
+    std::sort(files.begin(), files.end());
+    for (const std::string& file : files) {
+      fitted_q.add_file(file);
+      std::cout << "Read from file: " << file << std::endl;
+    }
+    std::cout << "records: " << fitted_q.size() << std::endl;
+    const char* epochs = get_cmd_option(argv, argv+argc, "-epochs");
+    std::vector<double> msve_epochs;
+    fitted_q.learn(epochs ? std::atoi(epochs) : 40, msve_epochs);
+    // Write the modified pages of a mapped table back to its file
+    if (approximator->weight_table()) approximator->weight_table()->sync();
+    // Same file as learning, deltas of an older base are ignored
+    approximator->save(std::string(working_directory) + "/approximator.dat");
+    std::cout << "Write into file: " << std::string(working_directory) + "/approximator.dat" << std::endl;
+  }
+
   // Fin.
   std::cout << "finished" << std::endl;
   return 0;
@@ -135,7 +409,8 @@ void learn_batch(Learner* learner, int batch_size, int episode_length,
     std::cout << "batch mean reward: " 
               << std::accumulate(reward_batch.begin(), reward_batch.end(), 0.0) / reward_batch.size() << std::endl
               << "batch msve: "
-              << std::accumulate(msve_batch.begin(), msve_batch.end(), 0.0) / msve_batch.size() << std::endl;
+              << std::accumulate(msve_batch.begin(), msve_batch.end(), 0.0) / msve_batch.size() << std::endl
+              << "write conflicts: " << learner->approximator->getWriteConflicts() << std::endl;
 }
 
 
@@ -153,4 +428,47 @@ void save_statistics(std::string filename, const double* msve_array,
       stats << msve_array[i] << "," << reward_array[i] << "\n";
     }
     stats.close();
+}
+
+
+void save_evaluations(std::string filename,
+  const std::vector<EvaluationResult>& evaluations) {
+    if (evaluations.empty()) return;
+    std::fstream stats;
+    stats.open(filename, std::ios_base::app | std::ios_base::ate);
+    // Output in CSV format
+    if (!stats.tellp()) {
+      stats << "BATCH,EPISODES,MEAN_REWARD,MEAN_LENGTH,MAX_LENGTH\n";
+    }
+    for (const EvaluationResult& evaluation : evaluations) {
+      std::cout << "evaluation of batch " << evaluation.batch
+                << ": mean reward " << evaluation.mean_reward
+                << ", mean length " << evaluation.mean_length << std::endl;
+      stats << evaluation.batch << "," << evaluation.episodes << ","
+            << evaluation.mean_reward << "," << evaluation.mean_length << ","
+            << evaluation.max_length << "\n";
+    }
+    stats.close();
+}
+
+
+void save_distributions(std::string filename, int number_of_episodes,
+  const Distribution& length, const Distribution& reward) {
+    std::ofstream stats(filename, std::ios_base::trunc);
+    stats << "METRIC,EPISODES,MEAN,P50,P90,P99,MAX\n";
+    auto output = [&](const char* metric, const Distribution& distribution) {
+      std::cout << metric << ": mean " << distribution.mean
+                << ", p50 " << distribution.p50
+                << ", p90 " << distribution.p90
+                << ", p99 " << distribution.p99
+                << ", max " << distribution.max << std::endl;
+      stats << metric << "," << number_of_episodes << ","
+            << distribution.mean << "," << distribution.p50 << ","
+            << distribution.p90 << "," << distribution.p99 << ","
+            << distribution.max << "\n";
+    };
+    std::cout << "episodes: " << number_of_episodes << std::endl;
+    output("length", length);
+    output("reward", reward);
+    std::cout << "Write into file: " << filename << std::endl;
 }
\ No newline at end of file
@@ -2,11 +2,27 @@
 #define __APPROXIMATOR_H_
 
 #include "Eigen/Dense"
+#include "src/approximator/checkpoint.h"
+#include "src/approximator/weight_table.h"
 #include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <utility>
 #include <vector>
 #include <string>
 #include <stdexcept>
 
+/**
+ * @brief Synchronization of concurrent predictions and updates.
+ */
+enum class ConcurrencyMode {
+    LOCKED,  //<! One lock per action serializes access (default)
+    HOGWILD, //<! Unsynchronized sparse updates, concurrent updates may be lost
+    ATOMIC,  //<! Lock-free atomic additions, no update is lost
+    BUFFERED //<! Updates collect in per-thread delta buffers which are merged periodically
+};
+
 /** 
  *  @brief Provides a generic interface for value function approximators. It is
  *         restricted to discrete action spaces.
@@ -14,6 +30,166 @@
 class Approximator {
   protected:
     std::vector<omp_lock_t> action_locks; //!< Lock for each action when using OMP
+    std::atomic<uint64_t> write_conflicts; //!< Estimated lost updates (HOGWILD) or compare-and-swap retries
+
+    /**
+     * @brief Weight changes of one thread which are not merged yet.
+     */
+    struct alignas(64) DeltaBuffer {
+        std::vector<std::pair<float*, float>> deltas; //!< Changed weight and its delta
+        std::vector<std::size_t> bounds;              //!< First delta of each merge range
+        std::vector<uint8_t> merged;                  //!< Merge range is done in the current merge
+        int updates = 0;                              //!< Updates since the last merge
+    };
+    std::vector<DeltaBuffer> delta_buffers; //!< One delta buffer per OpenMP thread
+    std::vector<omp_lock_t> range_locks;    //!< Lock for each merge range of the weight table
+    WeightTable* tracked_weights = nullptr; //!< Table whose changed blocks are recorded
+
+    static constexpr int MERGE_RANGES_PER_THREAD = 8; //!< Merge ranges of the weight table per thread
+    static constexpr uint32_t CONFLICT_SAMPLING = 64; //!< HOGWILD checks one of this many writes of a thread for conflicts
+
+    /**
+     * @brief Get the merge range of a weight.
+     * 
+     * @param weights Table of the weight
+     * @param weight Weight within the table
+     * @return Range index
+     */
+    std::size_t merge_range(const WeightTable& weights, const float* weight) const {
+        const std::size_t range_size = (weights.size() + range_locks.size() - 1) / range_locks.size();
+        return std::size_t(weight - weights.data()) / range_size;
+    }
+
+    /**
+     * @brief Adds a delta to a weight while holding the lock of its range.
+     *        Plain loads and stores suffice, merges hold the same lock.
+     * 
+     * @param weight Weight to change
+     * @param delta Value to add
+     */
+    static void add_locked(float* weight, float delta) {
+        float value;
+        __atomic_load(weight, &value, __ATOMIC_RELAXED);
+        value += delta;
+        __atomic_store(weight, &value, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @brief Sorts deltas by weight address and sums up duplicates.
+     * 
+     * @param deltas Changed weights and their deltas
+     */
+    static void coalesce(std::vector<std::pair<float*, float>>& deltas) {
+        std::sort(deltas.begin(), deltas.end(),
+            [](const std::pair<float*, float>& a, const std::pair<float*, float>& b) {
+                return a.first < b.first;
+            });
+        std::size_t unique = 0;
+        for (std::size_t i = 0; i < deltas.size(); i++) {
+            if (unique > 0 && deltas[unique-1].first == deltas[i].first) {
+                deltas[unique-1].second += deltas[i].second;
+            } else {
+                deltas[unique++] = deltas[i];
+            }
+        }
+        deltas.resize(unique);
+    }
+
+    /**
+     * @brief Adds a delta to one weight with a compare-and-swap loop.
+     * 
+     * @param weight Weight to change
+     * @param delta Value to add
+     */
+    void atomic_add_weight(float* weight, double delta) {
+        float expected, updated;
+        __atomic_load(weight, &expected, __ATOMIC_RELAXED);
+        do {
+            updated = expected + delta;
+            if (__atomic_compare_exchange(weight, &expected, &updated,
+                    true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+            write_conflicts.fetch_add(1, std::memory_order_relaxed);
+        } while (true);
+    }
+
+    /**
+     * @brief Acquires the lock of an action if the concurrency mode needs it.
+     * 
+     * @param action Action value
+     */
+    void lock_action(int action) {
+        if (concurrency_mode == ConcurrencyMode::LOCKED)
+            omp_set_lock(&action_locks[action]);
+    }
+
+    /**
+     * @brief Releases the lock acquired by lock_action.
+     * 
+     * @param action Action value
+     */
+    void unlock_action(int action) {
+        if (concurrency_mode == ConcurrencyMode::LOCKED)
+            omp_unset_lock(&action_locks[action]);
+    }
+
+    /**
+     * @brief Acquires the locks of all actions, in ascending order, if the
+     *        concurrency mode needs them. Sparse features span all actions.
+     * 
+     */
+    void lock_all_actions() {
+        for (int action = 0; action < number_of_actions; action++) lock_action(action);
+    }
+
+    /**
+     * @brief Releases the locks acquired by lock_all_actions.
+     * 
+     */
+    void unlock_all_actions() {
+        for (int action = number_of_actions - 1; action >= 0; action--) unlock_action(action);
+    }
+
+    /**
+     * @brief Adds a delta to one weight according to the concurrency mode.
+     *        HOGWILD is a plain load, add and store, a concurrent write of
+     *        the same weight may overwrite the update. One of
+     *        CONFLICT_SAMPLING writes of a thread reads the weight again
+     *        after the store, a changed value counts as CONFLICT_SAMPLING
+     *        lost updates. ATOMIC retries and counts the retries.
+     * 
+     * @param weight Weight to change
+     * @param delta Value to add
+     */
+    void add_weight(float* weight, double delta) {
+        if (tracked_weights) tracked_weights->mark_changed(weight);
+        if (concurrency_mode == ConcurrencyMode::LOCKED) {
+            *weight += delta;
+        } else if (concurrency_mode == ConcurrencyMode::HOGWILD) {
+            // Relaxed accesses compile to plain moves
+            float current;
+            __atomic_load(weight, &current, __ATOMIC_RELAXED);
+            float updated = current + delta;
+            __atomic_store(weight, &updated, __ATOMIC_RELAXED);
+            static thread_local uint32_t writes = 0;
+            if (++writes % CONFLICT_SAMPLING == 0) {
+                float stored;
+                __atomic_load(weight, &stored, __ATOMIC_RELAXED);
+                if (stored != updated)
+                    write_conflicts.fetch_add(CONFLICT_SAMPLING, std::memory_order_relaxed);
+            }
+        } else if (concurrency_mode == ConcurrencyMode::BUFFERED
+                && omp_get_thread_num() < int(delta_buffers.size())) {
+            delta_buffers[omp_get_thread_num()].deltas.emplace_back(weight, delta);
+        } else if (concurrency_mode == ConcurrencyMode::BUFFERED && weight_table()) {
+            // Threads without a buffer write like a merge
+            omp_lock_t& lock = range_locks[merge_range(*weight_table(), weight)];
+            omp_set_lock(&lock);
+            add_locked(weight, delta);
+            omp_unset_lock(&lock);
+        } else {
+            atomic_add_weight(weight, delta);
+        }
+    }
 
     /**
      * @brief Predicts the value of the given state-action pair.
@@ -43,16 +219,101 @@ class Approximator {
 
         for (int action_idx = 0; action_idx < actions.size(); action_idx++) {
             int action = actions[action_idx];
-            omp_set_lock(const_cast<omp_lock_t*>(&action_locks[action]));
+            lock_action(action);
             // Call implementation for single action
             td_error[action_idx] = predict_implementation(state,
                 actions[action_idx]);
-            omp_unset_lock(const_cast<omp_lock_t*>(&action_locks[action]));
+            unlock_action(action);
         }
 
         return td_error;
     }
 
+    /**
+     * @brief Predicts the values of all actions for one state.
+     * 
+     * @param state State vector
+     * @param values_out Output of one value per action
+     */
+    virtual void predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) {
+        for (int action = 0; action < number_of_actions; action++) {
+            lock_action(action);
+            values_out[action] = predict_implementation(state, action);
+            unlock_action(action);
+        }
+    }
+
+    /**
+     * @brief Selects the action with the highest value for one state.
+     * 
+     * @param state State vector
+     * @return Greedy action, the lowest action value wins ties
+     */
+    virtual int greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) {
+        Eigen::VectorXd values(number_of_actions);
+        predict_all_implementation(state, values);
+        int best = 0;
+        for (int action = 1; action < number_of_actions; action++) {
+            if (values[action] > values[best]) best = action;
+        }
+        return best;
+    }
+
+    /**
+     * @brief Predicts the values of a batch of state-action pairs.
+     * 
+     * @param states State vectors, one column per state
+     * @param actions Action of each state
+     * @param values_out Output of one value per state
+     */
+    virtual void predict_batch_implementation(
+        const Eigen::Ref<const Eigen::MatrixXd>& states,
+        const Eigen::Ref<const Eigen::VectorXi>& actions,
+        Eigen::Ref<Eigen::VectorXd> values_out) {
+        for (Eigen::Index i = 0; i < states.cols(); i++) {
+            lock_action(actions[i]);
+            values_out[i] = predict_implementation(states.col(i), actions[i]);
+            unlock_action(actions[i]);
+        }
+    }
+
+    /**
+     * @brief Updates a batch of state-action pairs one after another.
+     * 
+     * @param states State vectors, one column per state
+     * @param actions Action of each state
+     * @param targets Target value of each state-action pair
+     * @param errors_out Output of one value error per state
+     */
+    virtual void update_batch_implementation(
+        const Eigen::Ref<const Eigen::MatrixXd>& states,
+        const Eigen::Ref<const Eigen::VectorXi>& actions,
+        const Eigen::Ref<const Eigen::VectorXd>& targets,
+        Eigen::Ref<Eigen::VectorXd> errors_out) {
+        for (Eigen::Index i = 0; i < states.cols(); i++) {
+            lock_action(actions[i]);
+            errors_out[i] = update_implementation(states.col(i), actions[i], targets[i]);
+            unlock_action(actions[i]);
+        }
+    }
+
+    /**
+     * @brief Counts finished updates and merges the delta buffer of the
+     *        calling thread every merge_interval updates in BUFFERED mode.
+     * 
+     * @param updates Number of finished updates
+     */
+    void count_buffered_updates(int updates) {
+        if (concurrency_mode != ConcurrencyMode::BUFFERED) return;
+        int thread = omp_get_thread_num();
+        if (thread < int(delta_buffers.size())
+            && (delta_buffers[thread].updates += updates) >= merge_interval)
+            merge_deltas();
+    }
+
     /**
      * @brief Updates the value for a given state-action pair.
      * 
@@ -68,9 +329,32 @@ class Approximator {
         throw std::logic_error("Not implemented");
     }
 
+    /**
+     * @brief Updates the value for a given state-action pair with a scaled
+     *        step. The default predicts the value twice, approximators which
+     *        compute the error themselves should override it.
+     * 
+     * @param state State vector
+     * @param action Action value
+     * @param target Target value
+     * @param weight Factor of the step, e.g. an importance sampling weight
+     * @return Unscaled value error
+     */
+    virtual double weighted_update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target,
+        double weight) {
+        double prediction = predict_implementation(state, action);
+        update_implementation(state, action, prediction + weight * (target - prediction));
+        return target - prediction;
+    }
+
   public:
     const int number_of_actions;        //<! Number of discrete actions
     const int dimensions_of_statespace; //<! Size of the state vector
+    ConcurrencyMode concurrency_mode;   //<! Synchronization of concurrent access
+    int merge_interval;                 //<! Updates of a thread between merges in BUFFERED mode
 
     /**
      * @brief Construct a new Approximator object
@@ -79,8 +363,14 @@ class Approximator {
      * @param dimensions_of_statespace Size of the state vector
      */
     Approximator(int number_of_actions, int dimensions_of_statespace)
-      : number_of_actions(number_of_actions),
-        dimensions_of_statespace(dimensions_of_statespace) {
+      : write_conflicts(0),
+        number_of_actions(number_of_actions),
+        dimensions_of_statespace(dimensions_of_statespace),
+        concurrency_mode(ConcurrencyMode::LOCKED),
+        merge_interval(64) {
+      delta_buffers.resize(omp_get_max_threads());
+      range_locks.resize(delta_buffers.size() * MERGE_RANGES_PER_THREAD);
+      for (auto& lck : range_locks) omp_init_lock(&lck);
       action_locks.resize(number_of_actions);
       for (auto& lck : action_locks) omp_init_lock(&lck);
     }
@@ -91,6 +381,202 @@ class Approximator {
      */
     virtual ~Approximator() {
         for (auto& lck : action_locks) omp_destroy_lock(&lck);
+        for (auto& lck : range_locks) omp_destroy_lock(&lck);
+    }
+
+    /**
+     * @brief Get the number of conflicting writes: in HOGWILD mode an
+     *        estimate of the updates lost to a concurrent write of the same
+     *        weight, sampled from a few writes and only detecting overwrites
+     *        right after the store, so it is a rough lower bound; in ATOMIC
+     *        mode the exact number of compare-and-swap retries.
+     * 
+     * @return uint64_t 
+     */
+    uint64_t getWriteConflicts() const { return write_conflicts.load(); }
+
+    /**
+     * @brief Merges the delta buffer of the calling thread into the weights.
+     *        The buffer is sorted by weight and split at the boundaries of
+     *        the merge ranges of the table, each range is written under its
+     *        own lock. Threads start at different ranges and skip ranges
+     *        which another thread merges, so concurrent merges proceed in
+     *        parallel on disjoint parts of the table and no weight is
+     *        written by two threads at once.
+     * 
+     */
+    void merge_deltas() {
+        int thread = omp_get_thread_num();
+        if (thread >= int(delta_buffers.size())) return;
+        DeltaBuffer& buffer = delta_buffers[thread];
+        buffer.updates = 0;
+        if (buffer.deltas.empty()) return;
+        coalesce(buffer.deltas);
+        WeightTable* weights = weight_table();
+        if (!weights) {
+            for (const auto& delta : buffer.deltas) atomic_add_weight(delta.first, delta.second);
+            buffer.deltas.clear();
+            return;
+        }
+
+        // First delta of each range, the buffer is sorted by address
+        const std::size_t ranges = range_locks.size();
+        buffer.bounds.resize(ranges + 1);
+        buffer.merged.resize(ranges);
+        std::size_t position = 0, remaining = 0;
+        for (std::size_t range = 0; range < ranges; range++) {
+            buffer.bounds[range] = position;
+            while (position < buffer.deltas.size()
+                && merge_range(*weights, buffer.deltas[position].first) == range) position++;
+            buffer.merged[range] = position == buffer.bounds[range];
+            if (!buffer.merged[range]) remaining++;
+        }
+        buffer.bounds[ranges] = position;
+
+        const std::size_t start = thread * ranges / delta_buffers.size();
+        bool blocking = false;
+        while (remaining > 0) {
+            bool progress = false;
+            for (std::size_t i = 0; i < ranges && remaining > 0; i++) {
+                const std::size_t range = (start + i) % ranges;
+                if (buffer.merged[range]) continue;
+                if (blocking) {
+                    omp_set_lock(&range_locks[range]);
+                } else if (!omp_test_lock(&range_locks[range])) {
+                    continue;
+                }
+                for (std::size_t k = buffer.bounds[range]; k < buffer.bounds[range + 1]; k++) {
+                    if (tracked_weights) tracked_weights->mark_changed(buffer.deltas[k].first);
+                    add_locked(buffer.deltas[k].first, buffer.deltas[k].second);
+                }
+                omp_unset_lock(&range_locks[range]);
+                buffer.merged[range] = true;
+                remaining--;
+                progress = true;
+            }
+            // All remaining ranges are busy, wait for them
+            blocking = !progress;
+        }
+        buffer.deltas.clear();
+    }
+
+    /**
+     * @brief Get the table which stores the weights, e.g. to control their
+     *        memory placement.
+     * 
+     * @return WeightTable* or nullptr if the approximator has no weight table
+     */
+    virtual WeightTable* weight_table() { return nullptr; }
+
+    /**
+     * @brief Get the sparse features of a state-action pair, for learners
+     *        which keep state per weight like eligibility traces. The value
+     *        of the pair is the sum of weight times feature value, an index
+     *        may appear more than once.
+     * 
+     * @param state State vector
+     * @param action Action value
+     * @param indices_out Output of the weight index of each feature, room for max_features() entries
+     * @param values_out Output of the value of each feature, room for max_features() entries
+     * @return Number of features
+     */
+    virtual int features(
+      const Eigen::Ref<const Eigen::VectorXd>& state,
+      int action,
+      Eigen::Index* indices_out,
+      double* values_out) {
+        throw std::logic_error("Not implemented");
+    }
+
+    /**
+     * @brief Get the largest number of features of a state-action pair.
+     * 
+     * @return int 
+     */
+    virtual int max_features() const { return 0; }
+
+    /**
+     * @brief Get the step size of a single feature, the step size of the
+     *        approximator divided by the number of active features.
+     * 
+     * @return double 
+     */
+    virtual double feature_step_size() const {
+        throw std::logic_error("Not implemented");
+    }
+
+    /**
+     * @brief Sums the weights of sparse features times their values.
+     * 
+     * @param indices Weight index of each feature
+     * @param values Value of each feature
+     * @param count Number of features
+     * @return Weighted sum
+     */
+    double feature_sum(const Eigen::Index* indices, const double* values, int count) {
+        WeightTable* weights = weight_table();
+        if (!weights) throw std::logic_error("Approximator has no weight table.");
+        const float* data = weights->data();
+        lock_all_actions();
+        double sum = 0.0;
+        for (int i=0; i < count; i++) sum += data[indices[i]] * values[i];
+        unlock_all_actions();
+        return sum;
+    }
+
+    /**
+     * @brief Adds scale times the value of each sparse feature to its weight.
+     *        Counts as one update in BUFFERED mode.
+     * 
+     * @param indices Weight index of each feature
+     * @param values Value of each feature
+     * @param count Number of features
+     * @param scale Factor of all values, e.g. step size times error
+     */
+    void add_to_features(const Eigen::Index* indices, const double* values,
+      int count, double scale) {
+        WeightTable* weights = weight_table();
+        if (!weights) throw std::logic_error("Approximator has no weight table.");
+        float* data = weights->data();
+        lock_all_actions();
+        for (int i=0; i < count; i++) add_weight(data + indices[i], scale * values[i]);
+        unlock_all_actions();
+        count_buffered_updates(1);
+    }
+
+    /**
+     * @brief Starts recording which blocks of the weight table change for a
+     *        new consumer, e.g. an incremental checkpoint. The changes are
+     *        taken with WeightTable::take_changed_blocks.
+     * 
+     * @return Tracker of the consumer
+     */
+    int track_changes() {
+        WeightTable* weights = weight_table();
+        if (!weights) throw std::logic_error("Approximator has no weight table.");
+        const int tracker = weights->add_tracker();
+        tracked_weights = weights;
+        return tracker;
+    }
+
+    /**
+     * @brief Stops recording changes for a consumer
+     * 
+     * @param tracker Tracker returned by track_changes
+     */
+    void stop_tracking(int tracker) {
+        WeightTable* weights = weight_table();
+        weights->remove_tracker(tracker);
+        if (!weights->isTracked()) tracked_weights = nullptr;
+    }
+
+    /**
+     * @brief Describes the layout of the weight table for checkpoints.
+     * 
+     * @return Checkpoint
+     */
+    virtual Checkpoint checkpoint() const {
+        throw std::logic_error("Not implemented");
     }
 
     /**
@@ -107,6 +593,15 @@ class Approximator {
      */
     virtual void load(std::string filename) = 0;
 
+    /**
+     * @brief Uses the parameters of a checkpoint file in place instead of
+     *        copying them. Approximators without mappable parameters load
+     *        the file.
+     * 
+     * @param filename Name of file to map.
+     */
+    virtual void map(std::string filename) { load(filename); }
+
     /**
      * @brief Predicts the values of multiple state-action pairs.
      * 
@@ -127,6 +622,38 @@ class Approximator {
         return predict_implementation(state, actions);
     }
 
+    /**
+     * @brief Predicts the values of all actions from one index computation.
+     * 
+     * @param state State vector
+     * @param values_out Output of one value per action
+     */
+    void predict_all(
+      const Eigen::Ref<const Eigen::VectorXd>& state,
+      Eigen::Ref<Eigen::VectorXd> values_out) {
+        // Check input arguments
+        if (state.size() != dimensions_of_statespace)
+            throw std::invalid_argument("State vector has wrong size.");
+        if (values_out.size() != number_of_actions)
+            throw std::invalid_argument("Output vector has wrong size.");
+
+        predict_all_implementation(state, values_out);
+    }
+
+    /**
+     * @brief Selects the action with the highest value.
+     * 
+     * @param state State vector
+     * @return Greedy action
+     */
+    int greedy_action(const Eigen::Ref<const Eigen::VectorXd>& state) {
+        // Check input arguments
+        if (state.size() != dimensions_of_statespace)
+            throw std::invalid_argument("State vector has wrong size.");
+
+        return greedy_action_implementation(state);
+    }
+
     /**
      * @brief Updates the value for a given state-action pair.
      * 
@@ -146,12 +673,108 @@ class Approximator {
             throw std::invalid_argument("Action value is illegal.");
 
         double td_error;
-        omp_set_lock(&action_locks[action]);
+        lock_action(action);
         // Call implementation
         td_error = update_implementation(state, action, target);
-        omp_unset_lock(&action_locks[action]);
+        unlock_action(action);
+        // Buffered updates become visible every few steps
+        count_buffered_updates(1);
+        return td_error;
+    }
+
+    /**
+     * @brief Updates the value for a given state-action pair with a step
+     *        scaled by a weight, the value is only predicted once.
+     * 
+     * @param state State vector
+     * @param action Action value
+     * @param target Target state-action value
+     * @param weight Factor of the step, e.g. an importance sampling weight
+     * @return Unscaled value error
+     */
+    double update(
+      const Eigen::Ref<const Eigen::VectorXd>& state,
+      const int action,
+      double target,
+      double weight) {
+        // Check input arguments
+        if (state.size() != dimensions_of_statespace)
+            throw std::invalid_argument("State vector has wrong size.");
+        if (action < 0 || action >= number_of_actions)
+            throw std::invalid_argument("Action value is illegal.");
+
+        lock_action(action);
+        double td_error = weighted_update_implementation(state, action, target, weight);
+        unlock_action(action);
+        count_buffered_updates(1);
+        return td_error;
+    }
+
+    /**
+     * @brief Predicts the values of a batch of state-action pairs. The
+     *        arguments are validated once for the whole batch.
+     * 
+     * @param states State vectors, one column per state
+     * @param actions Action of each state
+     * @return Value of each state-action pair
+     */
+    Eigen::VectorXd predict_batch(
+      const Eigen::Ref<const Eigen::MatrixXd>& states,
+      const Eigen::Ref<const Eigen::VectorXi>& actions) {
+        // Check input arguments
+        check_batch(states, actions);
+
+        Eigen::VectorXd prediction(states.cols());
+        if (states.cols() > 0)
+            predict_batch_implementation(states, actions, prediction);
+        return prediction;
+    }
+
+    /**
+     * @brief Updates a batch of state-action pairs. The updates are applied
+     *        in column order, exactly as consecutive calls of update would.
+     * 
+     * @param states State vectors, one column per state
+     * @param actions Action of each state
+     * @param targets Target state-action value of each state
+     * @return Value error of each state-action pair
+     */
+    Eigen::VectorXd update_batch(
+      const Eigen::Ref<const Eigen::MatrixXd>& states,
+      const Eigen::Ref<const Eigen::VectorXi>& actions,
+      const Eigen::Ref<const Eigen::VectorXd>& targets) {
+        // Check input arguments
+        check_batch(states, actions);
+        if (targets.size() != states.cols())
+            throw std::invalid_argument("Target vector has wrong size.");
+
+        Eigen::VectorXd td_error(states.cols());
+        if (states.cols() > 0) {
+            update_batch_implementation(states, actions, targets, td_error);
+            count_buffered_updates(states.cols());
+        }
         return td_error;
     }
+
+  private:
+    /**
+     * @brief Validates the states and actions of a batch.
+     * 
+     * @param states State vectors, one column per state
+     * @param actions Action of each state
+     */
+    void check_batch(
+      const Eigen::Ref<const Eigen::MatrixXd>& states,
+      const Eigen::Ref<const Eigen::VectorXi>& actions) const {
+        if (states.rows() != dimensions_of_statespace)
+            throw std::invalid_argument("State matrix has wrong size.");
+        if (actions.size() != states.cols())
+            throw std::invalid_argument("Action vector has wrong size.");
+        if (actions.size() > 0 && (actions.minCoeff() < 0
+            || actions.maxCoeff() >= number_of_actions))
+            throw std::invalid_argument(
+                "Action vector contains illegal values.");
+    }
 };
 
 #endif
\ No newline at end of file
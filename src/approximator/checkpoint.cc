@@ -0,0 +1,181 @@
+#include "src/approximator/checkpoint.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+const char MAGIC[8] = {'R', 'L', 'A', 'G', 'E', 'N', 'T', 'C'};
+const uint32_t DTYPE_FLOAT32 = 1;
+const uint64_t CHECKSUM_BASIS = 0xcbf29ce484222325ULL;
+// Number of weights verified per read
+const std::size_t CHUNK_SIZE = 1 << 16;
+
+// FNV-1a over 64 bit words, length must be a multiple of 8 except at the end
+uint64_t checksum_update(uint64_t hash, const float* weights, std::size_t size) {
+    const char* bytes = reinterpret_cast<const char*>(weights);
+    const std::size_t length = size * sizeof(float);
+    for (std::size_t i = 0; i < length; i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + i, std::min(sizeof(word), length - i));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+}
+
+Checkpoint::Checkpoint(const std::string& type, int number_of_actions,
+        int dimensions_of_statespace)
+    : type(type), actions(number_of_actions),
+      dimensions(dimensions_of_statespace) {
+    if (type.size() >= sizeof(Header::type))
+        throw std::invalid_argument("Approximator type name is too long.");
+}
+
+void Checkpoint::add(int64_t value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    layout.insert(layout.end(), bytes, bytes + sizeof(value));
+}
+
+void Checkpoint::add(float value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    layout.insert(layout.end(), bytes, bytes + sizeof(value));
+}
+
+uint64_t Checkpoint::checksum(const float* weights, std::size_t size) {
+    return checksum_update(CHECKSUM_BASIS, weights, size);
+}
+
+Checkpoint::Header Checkpoint::make_header(std::size_t weight_count) const {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.dtype = DTYPE_FLOAT32;
+    std::memcpy(header.type, type.data(), type.size());
+    header.actions = actions;
+    header.dimensions = dimensions;
+    header.layout_size = layout.size();
+    // Weights start at the next aligned position after the layout
+    header.weight_offset = (sizeof(Header) + layout.size() + ALIGNMENT - 1)
+        / ALIGNMENT * ALIGNMENT;
+    header.weight_count = weight_count;
+    return header;
+}
+
+std::string Checkpoint::describe(std::size_t weight_count) const {
+    const Header header = make_header(weight_count);
+    std::string description(reinterpret_cast<const char*>(&header), sizeof(header));
+    description.append(layout.data(), layout.size());
+    return description;
+}
+
+uint64_t Checkpoint::save(const std::string& filename, const WeightTable& weights) const {
+    std::ofstream outfile(filename, std::ios_base::binary);
+    if (!outfile.is_open())
+        throw std::runtime_error("Cannot write checkpoint " + filename);
+    Header header = make_header(weights.size());
+    header.checksum = checksum(weights.data(), weights.size());
+    outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outfile.write(layout.data(), layout.size());
+    std::vector<char> padding(header.weight_offset - sizeof(header) - layout.size(), 0);
+    outfile.write(padding.data(), padding.size());
+    outfile.write(reinterpret_cast<const char*>(weights.data()),
+        static_cast<int64_t>(weights.size() * sizeof(float)));
+    if (!outfile)
+        throw std::runtime_error("Cannot write checkpoint " + filename);
+    return header.checksum;
+}
+
+bool Checkpoint::detect(const std::string& filename) {
+    std::ifstream infile(filename, std::ios_base::binary);
+    char magic[sizeof(MAGIC)];
+    infile.read(magic, sizeof(magic));
+    return infile && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+uint64_t Checkpoint::stored_checksum(const std::string& filename) {
+    std::ifstream infile(filename, std::ios_base::binary);
+    Header header;
+    infile.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!infile || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error("Not a checkpoint: " + filename);
+    return header.checksum;
+}
+
+Checkpoint::Header Checkpoint::read_header(
+        const std::string& filename, std::size_t weight_count) const {
+    std::ifstream infile(filename, std::ios_base::binary | std::ios_base::ate);
+    if (!infile.is_open())
+        throw std::runtime_error("Cannot read checkpoint " + filename);
+    const uint64_t file_size = infile.tellg();
+    infile.seekg(0);
+
+    Header header;
+    std::vector<char> stored_layout;
+    infile.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!infile || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error("Not a checkpoint: " + filename);
+    if (header.version != VERSION || header.dtype != DTYPE_FLOAT32)
+        throw std::runtime_error("Unsupported checkpoint version or type: " + filename);
+    if (header.layout_size == layout.size()) {
+        stored_layout.resize(header.layout_size);
+        infile.read(stored_layout.data(), stored_layout.size());
+    }
+
+    // A different configuration would silently produce garbage
+    Header expected = make_header(weight_count);
+    if (std::memcmp(header.type, expected.type, sizeof(header.type)) != 0
+        || header.actions != expected.actions
+        || header.dimensions != expected.dimensions
+        || header.weight_count != expected.weight_count
+        || stored_layout != layout)
+        throw std::runtime_error(
+            "Checkpoint does not match the approximator configuration: " + filename);
+    if (header.weight_offset % ALIGNMENT != 0 || file_size
+        < header.weight_offset + header.weight_count * sizeof(float))
+        throw std::runtime_error("Checkpoint is truncated: " + filename);
+    return header;
+}
+
+void Checkpoint::load(const std::string& filename, WeightTable& weights) const {
+    Header header = read_header(filename, weights.size());
+    std::ifstream infile(filename, std::ios_base::binary);
+    infile.seekg(header.weight_offset);
+
+    // Verified before the table is touched, a corrupt file keeps the old weights
+    std::vector<float> chunk(std::min(weights.size(), CHUNK_SIZE));
+    uint64_t hash = CHECKSUM_BASIS;
+    for (std::size_t first = 0; first < weights.size(); first += chunk.size()) {
+        std::size_t count = std::min(chunk.size(), weights.size() - first);
+        infile.read(reinterpret_cast<char*>(chunk.data()),
+            static_cast<int64_t>(count * sizeof(float)));
+        if (!infile) break;
+        hash = checksum_update(hash, chunk.data(), count);
+    }
+    if (!infile || hash != header.checksum)
+        throw std::runtime_error("Checkpoint checksum mismatch: " + filename);
+
+    infile.seekg(header.weight_offset);
+    infile.read(reinterpret_cast<char*>(weights.data()),
+        static_cast<int64_t>(weights.size() * sizeof(float)));
+    if (!infile)
+        throw std::runtime_error("Cannot read checkpoint " + filename);
+    weights.mark_all_changed();
+}
+
+WeightTable Checkpoint::map(const std::string& filename, std::size_t size,
+        bool verify) const {
+    Header header = read_header(filename, size);
+    // Offsets that are no multiple of the page size cannot be mapped
+    if (header.weight_offset % sysconf(_SC_PAGESIZE) != 0) {
+        WeightTable weights(size);
+        load(filename, weights);
+        return weights;
+    }
+    WeightTable weights(filename, header.weight_offset, size);
+    if (verify && checksum(weights.data(), size) != header.checksum)
+        throw std::runtime_error("Checkpoint checksum mismatch: " + filename);
+    return weights;
+}
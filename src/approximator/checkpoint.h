@@ -0,0 +1,157 @@
+#ifndef __CHECKPOINT_H_
+#define __CHECKPOINT_H_
+
+#include "src/approximator/weight_table.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Versioned, self-describing checkpoint of an approximator's weights.
+ *        The header records the approximator type, the action count, the
+ *        state size and a layout (e.g. segments, tilings and bounds) which
+ *        must match on load, the weight type and a checksum of the weights.
+ *        The weights follow in the in-memory layout at a page-aligned offset,
+ *        so a checkpoint can be mapped and used in place.
+ */
+class Checkpoint {
+  public:
+    static constexpr uint32_t VERSION = 1;          //<! Current format version
+    static constexpr std::size_t ALIGNMENT = 65536; //<! Offset of the weights is a multiple of this (any page size)
+
+    /**
+     * @brief Construct the description of an approximator
+     *
+     * @param type Name of the approximator class
+     * @param number_of_actions Number of discrete actions
+     * @param dimensions_of_statespace Size of state-space vector
+     */
+    Checkpoint(const std::string& type, int number_of_actions,
+        int dimensions_of_statespace);
+
+    /**
+     * @brief Appends an integer to the layout
+     *
+     * @param value Layout value, e.g. number of segments
+     */
+    void add(int64_t value);
+
+    /**
+     * @brief Appends a float to the layout, compared bitwise on load
+     *
+     * @param value Layout value, e.g. lower bound of a tiling
+     */
+    void add(float value);
+
+    /**
+     * @brief Serializes the header (without checksum) and the layout, e.g.
+     *        to check the layout of a mapped weight file
+     *
+     * @param weight_count Number of weights
+     * @return std::string
+     */
+    std::string describe(std::size_t weight_count) const;
+
+    /**
+     * @brief Writes the header and the weights to a file
+     *
+     * @param filename Checkpoint file
+     * @param weights Weights in memory layout
+     * @return Checksum of the weights
+     */
+    uint64_t save(const std::string& filename, const WeightTable& weights) const;
+
+    /**
+     * @brief Copies the weights of a checkpoint into a table. Throws a
+     *        runtime_error if the file does not match the description, has
+     *        the wrong size or a wrong checksum, the table is only changed
+     *        after the checksum was verified.
+     *
+     * @param filename Checkpoint file
+     * @param weights Table which receives the weights
+     */
+    void load(const std::string& filename, WeightTable& weights) const;
+
+    /**
+     * @brief Maps the weights of a checkpoint in place (copy-on-write), so
+     *        startup does not depend on the table size and processes share
+     *        the page cache. The header is always validated, the checksum
+     *        requires reading all weights and is optional.
+     *
+     * @param filename Checkpoint file
+     * @param size Expected number of weights
+     * @param verify Also verify the checksum of the weights
+     * @return Mapped weight table
+     */
+    WeightTable map(const std::string& filename, std::size_t size,
+        bool verify = false) const;
+
+    /**
+     * @brief Check whether a file starts with a checkpoint header. Older
+     *        files only contain the raw weights.
+     *
+     * @param filename File to check
+     * @return bool
+     */
+    static bool detect(const std::string& filename);
+
+    /**
+     * @brief Reads the checksum from the header of a checkpoint, without
+     *        reading the weights
+     *
+     * @param filename Checkpoint file
+     * @return uint64_t
+     */
+    static uint64_t stored_checksum(const std::string& filename);
+
+    /**
+     * @brief Computes the checksum stored in the header
+     *
+     * @param weights First weight
+     * @param size Number of weights
+     * @return uint64_t
+     */
+    static uint64_t checksum(const float* weights, std::size_t size);
+
+  private:
+    /**
+     * @brief Fixed part of the file header, followed by the layout
+     */
+    struct Header {
+        char magic[8];          //<! File signature
+        uint32_t version;       //<! Format version
+        uint32_t dtype;         //<! Weight type (1: 32 bit float)
+        char type[32];          //<! Approximator class
+        int32_t actions;        //<! Number of discrete actions
+        int32_t dimensions;     //<! Size of state-space vector
+        uint64_t layout_size;   //<! Bytes of layout following the header
+        uint64_t weight_offset; //<! Position of the first weight in the file
+        uint64_t weight_count;  //<! Number of weights
+        uint64_t checksum;      //<! Checksum of the weights
+    };
+
+    std::string type;          //<! Approximator class
+    int actions;               //<! Number of discrete actions
+    int dimensions;            //<! Size of state-space vector
+    std::vector<char> layout;  //<! Approximator specific description
+
+    /**
+     * @brief Builds the header for a number of weights
+     *
+     * @param weight_count Number of weights
+     * @return Header
+     */
+    Header make_header(std::size_t weight_count) const;
+
+    /**
+     * @brief Reads the header of a file and checks that it matches this
+     *        description and the expected number of weights.
+     *
+     * @param filename Checkpoint file
+     * @param weight_count Expected number of weights
+     * @return Header
+     */
+    Header read_header(const std::string& filename, std::size_t weight_count) const;
+};
+
+#endif
@@ -0,0 +1,331 @@
+#ifndef __FIXED_TILE_CODING_H_
+#define __FIXED_TILE_CODING_H_
+
+#include "src/approximator/approximator.h"
+#include "src/approximator/checkpoint.h"
+#include "src/approximator/tile_index_kernel.h"
+#include "src/approximator/weight_table.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <string>
+
+/**
+ * @brief Tile coding with the state size, the number of actions and the number
+ *        of tilings fixed at compile time. All loops have constant trip counts
+ *        and the typed methods (values, greedy, learn) are not virtual, so the
+ *        hot path has neither heap allocations nor dynamic sizes. The tilings
+ *        and the file format are the same as TileCoding without action kernel.
+ *
+ * @tparam StateDim Size of state-space vector
+ * @tparam Actions Number of discrete actions
+ * @tparam Tilings Number of tiling layers
+ */
+template <int StateDim, int Actions, int Tilings>
+class FixedTileCoding final : public Approximator {
+    static_assert(StateDim > 0 && StateDim <= TileIndexKernel::MAX_DIMENSIONS,
+        "State size is out of range.");
+    static_assert(Actions > 0, "Number of actions must be positive.");
+    static_assert(Tilings > 0 && Tilings <= TileIndexKernel::MAX_TILINGS,
+        "Number of tilings is out of range.");
+
+  public:
+    typedef Eigen::Matrix<int, StateDim, 1> IntState;     //<! Integer value per state dimension
+    typedef Eigen::Matrix<float, StateDim, 1> FloatState; //<! Float value per state dimension
+    typedef std::array<double, Actions> ActionValues;     //<! Value of each action
+
+    double step_size; //<! How much the updates affect the values
+
+    /**
+     * @brief Construct a new fixed-size tile coding object
+     *
+     * @param step_size Step size, also called learning rate
+     * @param displacement Displacement vector for each layer
+     * @param segments Number of segments for each state dimension
+     * @param min_values Minimum values of state-space
+     * @param max_values Maximum values of state-space
+     * @param init_min_value Minimum value for random initialization
+     * @param init_max_value Maximum value for random initialization
+     * @param weight_file Keeps the values in this memory-mapped file if not empty
+     */
+    FixedTileCoding(
+        double step_size,
+        const IntState &displacement,
+        const IntState &segments,
+        const FloatState &min_values,
+        const FloatState &max_values,
+        double init_min_value = 0.0, double init_max_value = 0.0,
+        const std::string &weight_file = "")
+      : Approximator(Actions, StateDim),
+        step_size(step_size) {
+          Eigen::Index table_size = 0;
+          for (int t=0; t < Tilings; t++) {
+              Eigen::Index size = 1;
+              for (int d=0; d < StateDim; d++) {
+                  // How big is each segment
+                  float segment_size = (max_values[d] - min_values[d]) / float(segments[d]);
+                  // How big is a "fundamental" tile
+                  float tile_size = segment_size / float(Tilings);
+                  float offset = tile_size * float(displacement[d]) * float(t);
+
+                  const int k = t * StateDim + d;
+                  axis_min[k] = min_values[d] - offset;
+                  axis_scale[k] = 1.0f / segment_size;
+                  axis_segments[k] = segments[d] + int(std::ceil(offset / segment_size));
+                  axis_last[k] = float(axis_segments[k] - 1);
+                  if (size > std::numeric_limits<Eigen::Index>::max()
+                      / Actions / axis_segments[k])
+                      throw std::overflow_error("Tiling is too large.");
+                  size *= axis_segments[k];
+              }
+              tiling_offset[t] = table_size;
+              tiling_size[t] = size;
+              if (table_size > std::numeric_limits<Eigen::Index>::max()
+                  - size * Actions)
+                  throw std::overflow_error("Weight table is too large.");
+              table_size += size * Actions;
+          }
+
+          // Reserve enough memory, each tile contributes a fraction of the value
+          init_min_value /= Tilings;
+          init_max_value /= Tilings;
+          values = weight_file.empty() ? WeightTable(table_size) :
+              WeightTable(table_size, weight_file, checkpoint().describe(table_size));
+          // A new mapped file is already zero
+          if (!values.isRestored()
+              && (init_min_value != 0 || init_max_value != 0 || !values.isMapped())) {
+              values.vector() = (Eigen::VectorXf::Random(table_size).array() + 1.0) / 2.0
+                  * (init_max_value - init_min_value) + init_min_value;
+          }
+    }
+
+    void save(std::string filename) override {
+        checkpoint().save(filename, values);
+    }
+
+    void load(std::string filename) override {
+        if (Checkpoint::detect(filename)) {
+            checkpoint().load(filename, values);
+            values.sync_replicas();
+            return;
+        }
+        // Files without header keep the action-major layout of each tiling
+        std::ifstream infile(filename, std::ios_base::binary | std::ios_base::ate);
+        if (infile.good()) {
+            if (uint64_t(infile.tellg()) != values.size() * sizeof(float))
+                throw std::runtime_error("File does not match the table size.");
+            infile.seekg(0);
+            for (int t=0; t < Tilings; t++) {
+                values.read_action_major(
+                    infile, tiling_offset[t], tiling_size[t], Actions);
+            }
+            infile.close();
+            values.sync_replicas();
+        }
+    }
+
+    void map(std::string filename) override {
+        if (Checkpoint::detect(filename)) {
+            values = checkpoint().map(filename, values.size());
+        } else {
+            load(filename);
+        }
+    }
+
+    WeightTable* weight_table() override { return &values; }
+
+    // Same description as TileCoding, so the files are interchangeable
+    Checkpoint checkpoint() const override {
+        Checkpoint description("TileCoding", Actions, StateDim);
+        description.add(int64_t(Tilings));
+        for (int t=0; t < Tilings; t++) {
+            description.add(int64_t(StateDim));
+            for (int d=0; d < StateDim; d++) {
+                const int k = t * StateDim + d;
+                description.add(int64_t(d));
+                description.add(axis_min[k]);
+                description.add(axis_scale[k]);
+                description.add(int64_t(axis_segments[k]));
+            }
+        }
+        return description;
+    }
+
+    int features(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        Eigen::Index* indices_out,
+        double* values_out) override {
+        Offsets offsets;
+        get_offsets(state.data(), offsets);
+        for (int t=0; t < Tilings; t++) {
+            indices_out[t] = offsets[t] + action;
+            values_out[t] = 1.0;
+        }
+        return Tilings;
+    }
+
+    int max_features() const override { return Tilings; }
+
+    double feature_step_size() const override { return step_size / Tilings; }
+
+    /**
+     * @brief Predicts the values of all actions without validation.
+     *
+     * @param state State vector with StateDim values
+     * @param values_out Output of one value per action
+     */
+    void action_values(const double* state, ActionValues& values_out) {
+        Offsets offsets;
+        get_offsets(state, offsets);
+        const float* weights = values.local_data();
+        for (int action = 0; action < Actions; action++) {
+            lock_action(action);
+            values_out[action] = value(weights, offsets, action);
+            unlock_action(action);
+        }
+    }
+
+    /**
+     * @brief Selects the action with the highest value without validation.
+     *
+     * @param state State vector with StateDim values
+     * @return Greedy action, the lowest action value wins ties
+     */
+    int greedy(const double* state) {
+        ActionValues action_value;
+        action_values(state, action_value);
+        int best_action = 0;
+        for (int action = 1; action < Actions; action++) {
+            if (action_value[action] > action_value[best_action]) best_action = action;
+        }
+        return best_action;
+    }
+
+    /**
+     * @brief Updates the value of a state-action pair without validation,
+     *        synchronized like update.
+     *
+     * @param state State vector with StateDim values
+     * @param action Action value
+     * @param target Target value
+     * @return Value error
+     */
+    double learn(const double* state, int action, double target) {
+        lock_action(action);
+        double prediction_error = update_tiles(state, action, target);
+        unlock_action(action);
+        count_buffered_updates(1);
+        return prediction_error;
+    }
+
+  private:
+    typedef std::array<Eigen::Index, Tilings> Offsets;
+
+    // Axis parameters as [tiling][state dimension]
+    std::array<float, Tilings * StateDim> axis_min;   //<! Lower bound of the tiling
+    std::array<float, Tilings * StateDim> axis_scale; //<! Inverse size of a segment
+    std::array<float, Tilings * StateDim> axis_last;  //<! Largest segment index
+    std::array<int, Tilings * StateDim> axis_segments; //<! Number of segments
+    std::array<Eigen::Index, Tilings> tiling_offset;  //<! Start of each tiling in the weight table
+    std::array<Eigen::Index, Tilings> tiling_size;    //<! Number of states covered by each tiling
+    WeightTable values;                               //<! State-action values of all tilings
+
+    /**
+     * @brief Applies the update of one state-action pair to its active tiles.
+     *
+     * @param state State vector with StateDim values
+     * @param action Action value
+     * @param target Target value
+     * @param weight Factor of the step
+     * @return Unscaled value error
+     */
+    double update_tiles(const double* state, int action, double target,
+            double weight = 1.0) {
+        Offsets offsets;
+        get_offsets(state, offsets);
+        // One prediction over all tilings and one shared error
+        double prediction_error = target - value(values.data(), offsets, action);
+        double delta = weight * prediction_error * step_size / Tilings;
+        for (int t=0; t < Tilings; t++) {
+            add_weight(values.data() + offsets[t] + action, delta);
+        }
+        return prediction_error;
+    }
+
+    /**
+     * @brief Get the index of the active tile's first action in every tiling.
+     *
+     * @param state State vector with StateDim values
+     * @param offsets_out Output of one weight index per tiling
+     */
+    void get_offsets(const double* state, Offsets& offsets_out) const {
+        float x[StateDim];
+        for (int d=0; d < StateDim; d++) x[d] = float(state[d]);
+        for (int t=0; t < Tilings; t++) {
+            Eigen::Index index = 0;
+            for (int d=0; d < StateDim; d++) {
+                const int k = t * StateDim + d;
+                float position = (x[d] - axis_min[k]) * axis_scale[k];
+                position = std::min(std::max(position, 0.0f), axis_last[k]);
+                index = index * axis_segments[k] + Eigen::Index(position);
+            }
+            offsets_out[t] = tiling_offset[t] + index * Actions;
+        }
+    }
+
+    /**
+     * @brief Sums the values of the active tiles for one action.
+     *
+     * @param weights Weights to read, the primary table or a local replica
+     * @param offsets Active tile of each tiling
+     * @param action Action value
+     * @return State-action value
+     */
+    double value(const float* weights, const Offsets& offsets, int action) const {
+        double prediction = 0.0;
+        for (int t=0; t < Tilings; t++) prediction += weights[offsets[t] + action];
+        return prediction;
+    }
+
+  protected:
+    double predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        int action) override {
+        Offsets offsets;
+        get_offsets(state.data(), offsets);
+        return value(values.local_data(), offsets, action);
+    }
+
+    void predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) override {
+        ActionValues action_value;
+        action_values(state.data(), action_value);
+        for (int action = 0; action < Actions; action++) values_out[action] = action_value[action];
+    }
+
+    int greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) override {
+        return greedy(state.data());
+    }
+
+    double update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target) override {
+        return update_tiles(state.data(), action, target);
+    }
+
+    double weighted_update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target,
+        double weight) override {
+        return update_tiles(state.data(), action, target, weight);
+    }
+};
+
+#endif
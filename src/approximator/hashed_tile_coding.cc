@@ -0,0 +1,258 @@
+#include "src/approximator/hashed_tile_coding.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <omp.h>
+
+namespace {
+// Finalizer of splitmix64, spreads the tile coordinates over all bits
+uint64_t mix(uint64_t h) {
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+}
+
+HashedTileCoding::HashedTileCoding(
+    int number_of_actions,
+    int dimensions_of_statespace,
+    double step_size,
+    int tilings,
+    std::size_t memory_size,
+    const Eigen::Ref<const Eigen::VectorXi> &displacement,
+    const Eigen::Ref<const Eigen::VectorXi> &segments,
+    const Eigen::Ref<const Eigen::VectorXf> &min_values,
+    const Eigen::Ref<const Eigen::VectorXf> &max_values,
+    const Eigen::Ref<const Eigen::VectorXf> &action_kernel,
+    double init_min_value, double init_max_value)
+  : Approximator(number_of_actions, dimensions_of_statespace),
+    step_size(step_size),
+    tilings(tilings),
+    capacity(memory_size),
+    action_kernel(action_kernel),
+    keys(new std::atomic<uint64_t>[memory_size]),
+    occupancy(0),
+    collision_counters(std::max(1, omp_get_max_threads())),
+    collisions(new CollisionCounter[collision_counters]) {
+      if (tilings < 1 || tilings > MAX_TILINGS)
+          throw std::invalid_argument("Number of tilings is out of range.");
+      if (memory_size == 0)
+          throw std::invalid_argument("Memory size must not be zero.");
+      if (memory_size > std::size_t(std::numeric_limits<Eigen::Index>::max())
+          / number_of_actions)
+          throw std::overflow_error("Memory size is too large.");
+
+      // How big is each segment
+      Eigen::VectorXf segment_size = (max_values - min_values).array()
+          / segments.cast<float>().array();
+      segment_scale = segment_size.cwiseInverse();
+
+      // How big is a "fundamental" tile
+      Eigen::VectorXf tile_size = segment_size.array() / float(tilings);
+
+      // Tiles are unbounded, only the origin of each tiling is shifted
+      tiling_min_values.resize(dimensions_of_statespace, tilings);
+      for (int i=0; i < tilings; i++) {
+          tiling_min_values.col(i) = min_values.array()
+              - tile_size.array() * displacement.cast<float>().array() * float(i);
+      }
+
+      for (std::size_t slot = 0; slot < capacity; slot++) keys[slot].store(0);
+
+      // Reserve the weight budget, each tile contributes a fraction of the value
+      init_min_value /= tilings;
+      init_max_value /= tilings;
+      Eigen::Index size = capacity * number_of_actions;
+      values = WeightTable(size);
+      values.vector() = (Eigen::VectorXf::Random(size).array() + 1.0) / 2.0
+          * (init_max_value - init_min_value) + init_min_value;
+}
+
+void HashedTileCoding::save(std::string filename) {
+    std::ofstream outfile(filename, std::ios_base::binary);
+    if (outfile.is_open()) {
+        uint64_t header[4] = {
+            capacity, uint64_t(number_of_actions),
+            occupancy.load(), getCollisions()};
+        outfile.write(reinterpret_cast<const char*>(header), sizeof(header));
+        for (std::size_t slot = 0; slot < capacity; slot++) {
+            uint64_t key = keys[slot].load(std::memory_order_relaxed);
+            outfile.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        }
+        outfile.write(
+            reinterpret_cast<const char*>(values.data()),
+            static_cast<int64_t>(values.size() * sizeof(values[0])));
+        outfile.close();
+    }
+}
+
+void HashedTileCoding::load(std::string filename) {
+    std::ifstream infile(filename, std::ios_base::binary);
+    if (infile.good()) {
+        uint64_t header[4];
+        infile.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!infile || header[0] != capacity
+            || header[1] != uint64_t(number_of_actions))
+            throw std::runtime_error("File does not match the memory size.");
+        occupancy.store(header[2]);
+        for (int i = 0; i < collision_counters; i++)
+            collisions[i].count.store(i == 0 ? header[3] : 0);
+        for (std::size_t slot = 0; slot < capacity; slot++) {
+            uint64_t key = 0;
+            infile.read(reinterpret_cast<char*>(&key), sizeof(key));
+            keys[slot].store(key, std::memory_order_relaxed);
+        }
+        infile.read(
+            reinterpret_cast<char*>(values.data()),
+            static_cast<int64_t>(values.size() * sizeof(values[0])));
+        infile.close();
+        values.mark_all_changed();
+        values.sync_replicas();
+    }
+}
+
+std::size_t HashedTileCoding::getCollisions() const {
+    std::size_t sum = 0;
+    for (int i = 0; i < collision_counters; i++)
+        sum += collisions[i].count.load(std::memory_order_relaxed);
+    return sum;
+}
+
+std::size_t HashedTileCoding::get_slot(uint64_t fingerprint, bool readonly) {
+    std::size_t home = fingerprint % capacity;
+    // Linear probing, free slots are claimed lock-free
+    for (int probe = 0; probe < MAX_PROBES; probe++) {
+        std::size_t slot = (home + probe) % capacity;
+        uint64_t key = keys[slot].load(std::memory_order_relaxed);
+        if (key == 0) {
+            if (readonly) return slot;
+            if (keys[slot].compare_exchange_strong(key, fingerprint)) {
+                occupancy.fetch_add(1, std::memory_order_relaxed);
+                return slot;
+            }
+            // Another thread claimed the slot, key holds its fingerprint
+        }
+        if (key == fingerprint) return slot;
+    }
+    // Table is (locally) full, share the home slot with another tile
+    if (!readonly) {
+        collisions[omp_get_thread_num() % collision_counters].count.fetch_add(
+            1, std::memory_order_relaxed);
+    }
+    return home;
+}
+
+void HashedTileCoding::get_offsets(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Index* offsets_out,
+        bool readonly) {
+    const int dims = dimensions_of_statespace;
+    for (int t=0; t < tilings; t++) {
+        const float* lower = tiling_min_values.col(t).data();
+        uint64_t fingerprint = mix(uint64_t(t) + 1);
+        for (int d=0; d < dims; d++) {
+            int64_t cell = int64_t(std::floor(
+                (float(state[d]) - lower[d]) * segment_scale[d]));
+            fingerprint = mix(fingerprint ^ uint64_t(cell));
+        }
+        // Zero marks a free slot
+        if (fingerprint == 0) fingerprint = 1;
+        offsets_out[t] = Eigen::Index(get_slot(fingerprint, readonly)) * number_of_actions;
+    }
+}
+
+double HashedTileCoding::value(
+        const float* weights, const Eigen::Index* offsets, int action) const {
+    double prediction = 0.0;
+    for (int t=0; t < tilings; t++) {
+        const float* tile = weights + offsets[t];
+        // Action-kernel defines the influence of "neigboring" actions
+        double tile_value = action_kernel[0] * tile[action];
+        for (int i=1; i < action_kernel.size(); i++) {
+            int action_p = std::min(action + i, number_of_actions-1);
+            int action_n = std::max(action - i, 0);
+            tile_value += action_kernel[i] * tile[action_p]
+                + action_kernel[i] * tile[action_n];
+        }
+        prediction += tile_value;
+    }
+    return prediction;
+}
+
+double HashedTileCoding::predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        int action) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets, true);
+    return value(values.local_data(), offsets, action);
+}
+
+Eigen::VectorXd HashedTileCoding::predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        const Eigen::Ref<const Eigen::VectorXi>& actions) {
+    // Tile slots are shared by all actions
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets, true);
+
+    Eigen::VectorXd prediction(actions.size());
+    for (int action_idx = 0; action_idx < actions.size(); action_idx++) {
+        int action = actions[action_idx];
+        lock_action(action);
+        prediction[action_idx] = value(values.local_data(), offsets, action);
+        unlock_action(action);
+    }
+    return prediction;
+}
+
+void HashedTileCoding::predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets, true);
+    for (int action = 0; action < number_of_actions; action++) {
+        lock_action(action);
+        values_out[action] = value(values.local_data(), offsets, action);
+        unlock_action(action);
+    }
+}
+
+int HashedTileCoding::greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets, true);
+    int best_action = 0;
+    double best_value = 0.0;
+    for (int action = 0; action < number_of_actions; action++) {
+        lock_action(action);
+        double action_value = value(values.local_data(), offsets, action);
+        unlock_action(action);
+        if (action == 0 || action_value > best_value) {
+            best_action = action;
+            best_value = action_value;
+        }
+    }
+    return best_action;
+}
+
+double HashedTileCoding::update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets, false);
+    // One prediction over all tilings and one shared error
+    double prediction_error = target - value(values.data(), offsets, action);
+    double delta = prediction_error * step_size / tilings;
+    for (int t=0; t < tilings; t++) {
+        float* tile = values.data() + offsets[t];
+        add_weight(&tile[action], action_kernel[0] * delta);
+        for (int i=1; i < action_kernel.size(); i++) {
+            int action_p = std::min(action + i, number_of_actions-1);
+            int action_n = std::max(action - i, 0);
+            add_weight(&tile[action_p], action_kernel[i] * delta);
+            add_weight(&tile[action_n], action_kernel[i] * delta);
+        }
+    }
+    return prediction_error;
+}
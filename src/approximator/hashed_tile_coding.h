@@ -0,0 +1,155 @@
+#ifndef __HASHED_TILE_CODING_H_
+#define __HASHED_TILE_CODING_H_
+
+#include "src/approximator/approximator.h"
+#include "src/approximator/weight_table.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief Tile coding with a fixed memory budget. Tiles are mapped to a fixed
+ *        number of weight slots through an index hash table (IHT) as proposed
+ *        by Sutton. When no free slot is found, tiles share a slot and the
+ *        collision is counted. Only updates insert tiles, predictions look
+ *        up the slot an unknown tile would get without claiming it.
+ */
+class HashedTileCoding : public Approximator {
+  public:
+    static constexpr int MAX_TILINGS = 64; //<! Upper bound for the number of tilings
+    static constexpr int MAX_PROBES = 16;  //<! Slots searched before a collision is accepted
+
+    double step_size; //<! How much the updates affect the values
+
+    /**
+     * @brief Construct a new hashed tile coding object
+     *
+     * @param number_of_actions Number of discrete actions
+     * @param dimensions_of_statespace Size of state-space vector
+     * @param step_size Step size, also called learning rate
+     * @param tilings Number of tiling layers
+     * @param memory_size Number of tiles that can be stored (weight budget / actions)
+     * @param displacement Displacement vector for each layer
+     * @param segments Number of segments for each state dimension
+     * @param min_values Minimum values of state-space
+     * @param max_values Maximum values of state-space
+     * @param action_kernel Defines the influence of an action to its neighboring actions
+     * @param init_min_value Minimum value for random initialization
+     * @param init_max_value Maximum value for random initialization
+     */
+    HashedTileCoding(
+        int number_of_actions,
+        int dimensions_of_statespace,
+        double step_size,
+        int tilings,
+        std::size_t memory_size,
+        const Eigen::Ref<const Eigen::VectorXi> &displacement,
+        const Eigen::Ref<const Eigen::VectorXi> &segments,
+        const Eigen::Ref<const Eigen::VectorXf> &min_values,
+        const Eigen::Ref<const Eigen::VectorXf> &max_values,
+        const Eigen::Ref<const Eigen::VectorXf> &action_kernel = (Eigen::Matrix<float, 1, 1>()<< 1.0).finished(),
+        double init_min_value = 0.0, double init_max_value = 0.0);
+
+    void save(std::string filename) override;
+
+    void load(std::string filename) override;
+
+    WeightTable* weight_table() override { return &values; }
+
+    /**
+     * @brief Get the number of tiles that can be stored
+     *
+     * @return std::size_t
+     */
+    std::size_t getCapacity() const { return capacity; }
+
+    /**
+     * @brief Get the number of occupied tile slots
+     *
+     * @return std::size_t
+     */
+    std::size_t getOccupancy() const { return occupancy.load(); }
+
+    /**
+     * @brief Get the number of updates of tiles that share a slot with
+     *        another tile (summed over the threads)
+     *
+     * @return std::size_t
+     */
+    std::size_t getCollisions() const;
+
+  private:
+    int tilings;                       //<! Number of tilings
+    std::size_t capacity;              //<! Number of tile slots
+    Eigen::VectorXf action_kernel;     //<! Influence of an action to its neighboring actions
+    Eigen::VectorXf segment_scale;     //<! Inverse size of a segment for each state dimension
+    Eigen::MatrixXf tiling_min_values; //<! Origin of each tiling (one column per tiling)
+    std::unique_ptr<std::atomic<uint64_t>[]> keys; //<! Tile fingerprint of each slot, 0 if free
+    std::atomic<uint64_t> occupancy;   //<! Number of occupied slots
+
+    /**
+     * @brief Collisions counted by one thread, on its own cache line.
+     */
+    struct alignas(64) CollisionCounter {
+        std::atomic<uint64_t> count{0}; //<! Updates without an own slot
+    };
+    int collision_counters;            //<! Number of collision counters
+    std::unique_ptr<CollisionCounter[]> collisions; //<! One collision counter per OpenMP thread
+    WeightTable values;                //<! State-action values, actions of a slot are adjacent
+
+    /**
+     * @brief Get the index of the active tile's first action in every tiling.
+     *
+     * @param state State vector
+     * @param offsets_out Output of one weight index per tiling
+     * @param readonly Unknown tiles are not inserted into the index hash table
+     */
+    void get_offsets(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Index* offsets_out,
+        bool readonly);
+
+    /**
+     * @brief Find or claim the slot of a tile. Read-only lookups of unknown
+     *        tiles return the free slot the tile would claim, whose weights
+     *        still hold their initial values.
+     *
+     * @param fingerprint Hash of the tile coordinates (never 0)
+     * @param readonly Do not claim a free slot and do not count collisions
+     * @return Slot index
+     */
+    std::size_t get_slot(uint64_t fingerprint, bool readonly);
+
+    /**
+     * @brief Sums the values of the active tiles for one action.
+     *
+     * @param weights Weights to read, the primary table or a local replica
+     * @param offsets Active tile of each tiling
+     * @param action Action value
+     * @return State-action value
+     */
+    double value(const float* weights, const Eigen::Index* offsets, int action) const;
+
+  protected:
+    double predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        int action) override;
+
+    Eigen::VectorXd predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        const Eigen::Ref<const Eigen::VectorXi>& actions) override;
+
+    void predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) override;
+
+    int greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) override;
+
+    double update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target) override;
+};
+
+#endif
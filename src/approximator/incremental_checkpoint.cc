@@ -0,0 +1,306 @@
+#include "src/approximator/incremental_checkpoint.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+const char DELTA_MAGIC[8] = {'R', 'L', 'A', 'G', 'D', 'E', 'L', 'T'};
+// Longest encoding of a block, the worst case is 3 words per 2 weights
+const std::size_t MAX_ENCODED_WORDS = 2 * WeightTable::BLOCK_SIZE;
+
+// Header of the delta file, followed by groups of encoded blocks
+struct DeltaHeader {
+    char magic[8];          // File signature
+    uint64_t base_checksum; // Checksum of the base the deltas apply to
+    uint64_t block_size;    // Weights per block
+};
+
+uint32_t bits(float value) {
+    uint32_t result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+// Run-length encoding of zero words: (zeros, literals, literal words...)*
+void encode(const uint32_t* words, std::size_t count, std::vector<uint32_t>& out) {
+    std::size_t i = 0;
+    while (i < count) {
+        uint32_t zeros = 0;
+        while (i < count && words[i] == 0) { zeros++; i++; }
+        std::size_t first = i;
+        while (i < count && words[i] != 0) i++;
+        out.push_back(zeros);
+        out.push_back(uint32_t(i - first));
+        out.insert(out.end(), words + first, words + i);
+    }
+}
+
+// XORs an encoded block into count weights, only checks the encoding if
+// target is null. Returns false if the encoding does not fit the block.
+bool decode(const uint32_t* encoded, std::size_t size, float* target, std::size_t count) {
+    std::size_t k = 0, position = 0;
+    while (position + 2 <= size) {
+        k += encoded[position];
+        uint32_t literals = encoded[position + 1];
+        position += 2;
+        if (k > count || literals > count - k || literals > size - position) return false;
+        for (uint32_t l = 0; target && l < literals; l++) {
+            uint32_t value = bits(target[k + l]) ^ encoded[position + l];
+            std::memcpy(&target[k + l], &value, sizeof(value));
+        }
+        k += literals;
+        position += literals;
+    }
+    return position == size;
+}
+}
+
+IncrementalCheckpoint::IncrementalCheckpoint(
+        const std::shared_ptr<Approximator>& approximator,
+        const std::string& filename,
+        int compaction_interval)
+    : approximator(approximator),
+      filename(filename),
+      compaction_interval(std::max(1, compaction_interval)),
+      deltas(0),
+      description(approximator->checkpoint()),
+      mapped(false),
+      tracker(-1),
+      delta_bytes(0),
+      busy(false),
+      stop(false) {
+    WeightTable* weights = approximator->weight_table();
+    if (!weights) throw std::logic_error("Approximator has no weight table.");
+    writer = std::thread(&IncrementalCheckpoint::run, this);
+    // A second copy would not fit, the file already keeps the weights
+    mapped = weights->isMapped();
+    if (mapped) return;
+    shadow = WeightTable(*weights);
+    tracker = approximator->track_changes();
+    // First base from the copy taken above
+    std::unique_lock<std::mutex> lock(mutex);
+    pending.reset(new Job());
+    pending->compact = true;
+    condition.notify_all();
+}
+
+IncrementalCheckpoint::~IncrementalCheckpoint() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return !pending && !busy; });
+        stop = true;
+    }
+    condition.notify_all();
+    writer.join();
+    if (tracker >= 0) approximator->stop_tracking(tracker);
+}
+
+void IncrementalCheckpoint::save() {
+    submit(!mapped && ++deltas >= compaction_interval);
+}
+
+void IncrementalCheckpoint::compact() {
+    submit(true);
+}
+
+void IncrementalCheckpoint::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return !pending && !busy; });
+    if (!error.empty()) {
+        std::string message;
+        std::swap(message, error);
+        throw std::runtime_error(message);
+    }
+}
+
+std::size_t IncrementalCheckpoint::getDeltaBytes() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return !pending && !busy; });
+    return delta_bytes;
+}
+
+void IncrementalCheckpoint::submit(bool compact) {
+    // The previous snapshot must be written before the shadow copy changes
+    wait();
+    if (compact) deltas = 0;
+
+    std::unique_ptr<Job> job(new Job());
+    WeightTable* weights = approximator->weight_table();
+    if (mapped) {
+        // The base is a copy of the file for runs without -mmap
+        if (compact) write_base(*weights);
+        std::unique_lock<std::mutex> lock(mutex);
+        pending = std::move(job);
+        condition.notify_all();
+        return;
+    }
+    job->compact = compact;
+    job->blocks = weights->take_changed_blocks(tracker);
+    job->values.resize(job->blocks.size() * WeightTable::BLOCK_SIZE);
+    for (std::size_t i = 0; i < job->blocks.size(); i++) {
+        std::size_t first = job->blocks[i] * WeightTable::BLOCK_SIZE;
+        std::size_t count = std::min(WeightTable::BLOCK_SIZE, weights->size() - first);
+        std::memcpy(job->values.data() + i * WeightTable::BLOCK_SIZE,
+            weights->data() + first, count * sizeof(float));
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    pending = std::move(job);
+    condition.notify_all();
+}
+
+void IncrementalCheckpoint::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this] { return pending || stop; });
+        if (!pending) return;
+        std::unique_ptr<Job> job = std::move(pending);
+        busy = true;
+        lock.unlock();
+
+        std::string message;
+        try {
+            if (mapped) {
+                approximator->weight_table()->sync();
+            } else if (job->compact) {
+                // The changed blocks only update the shadow copy
+                for (std::size_t i = 0; i < job->blocks.size(); i++) {
+                    std::size_t first = job->blocks[i] * WeightTable::BLOCK_SIZE;
+                    std::size_t count = std::min(WeightTable::BLOCK_SIZE, shadow.size() - first);
+                    std::memcpy(shadow.data() + first,
+                        job->values.data() + i * WeightTable::BLOCK_SIZE,
+                        count * sizeof(float));
+                }
+                write_base(shadow);
+            } else {
+                write_delta(*job);
+            }
+        } catch (const std::exception& e) {
+            message = e.what();
+        }
+
+        lock.lock();
+        if (!message.empty()) error = message;
+        busy = false;
+        condition.notify_all();
+    }
+}
+
+void IncrementalCheckpoint::write_base(const WeightTable& weights) {
+    // Replace the base atomically, a crash keeps the old base and deltas
+    const std::string temporary = filename + ".tmp";
+    const uint64_t checksum = description.save(temporary, weights);
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+        throw std::runtime_error("Cannot replace checkpoint " + filename);
+
+    // Deltas of the old base do not match the new checksum anymore
+    std::ofstream outfile(filename + ".delta", std::ios_base::binary | std::ios_base::trunc);
+    DeltaHeader header;
+    std::memcpy(header.magic, DELTA_MAGIC, sizeof(DELTA_MAGIC));
+    header.base_checksum = checksum;
+    header.block_size = WeightTable::BLOCK_SIZE;
+    outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!outfile)
+        throw std::runtime_error("Cannot write checkpoint deltas " + filename + ".delta");
+    delta_bytes = 0;
+}
+
+void IncrementalCheckpoint::write_delta(const Job& job) {
+    std::vector<uint32_t> encoded;
+    std::vector<uint32_t> difference(WeightTable::BLOCK_SIZE);
+    const uint64_t blocks = job.blocks.size();
+    encoded.insert(encoded.end(),
+        reinterpret_cast<const uint32_t*>(&blocks),
+        reinterpret_cast<const uint32_t*>(&blocks) + 2);
+    for (std::size_t i = 0; i < job.blocks.size(); i++) {
+        std::size_t first = job.blocks[i] * WeightTable::BLOCK_SIZE;
+        std::size_t count = std::min(WeightTable::BLOCK_SIZE, shadow.size() - first);
+        const float* values = job.values.data() + i * WeightTable::BLOCK_SIZE;
+        float* previous = shadow.data() + first;
+        // Unchanged weights become zero words
+        for (std::size_t k = 0; k < count; k++) {
+            difference[k] = bits(values[k]) ^ bits(previous[k]);
+        }
+        std::memcpy(previous, values, count * sizeof(float));
+
+        const uint64_t block = job.blocks[i];
+        encoded.insert(encoded.end(),
+            reinterpret_cast<const uint32_t*>(&block),
+            reinterpret_cast<const uint32_t*>(&block) + 2);
+        std::size_t size_position = encoded.size();
+        encoded.push_back(0);
+        encode(difference.data(), count, encoded);
+        encoded[size_position] = uint32_t(encoded.size() - size_position - 1);
+    }
+
+    std::ofstream outfile(filename + ".delta", std::ios_base::binary | std::ios_base::app);
+    outfile.write(reinterpret_cast<const char*>(encoded.data()),
+        static_cast<int64_t>(encoded.size() * sizeof(uint32_t)));
+    if (!outfile)
+        throw std::runtime_error("Cannot write checkpoint deltas " + filename + ".delta");
+    delta_bytes = encoded.size() * sizeof(uint32_t);
+}
+
+void IncrementalCheckpoint::restore(Approximator& approximator, const std::string& filename) {
+    std::ifstream infile(filename + ".delta", std::ios_base::binary);
+    if (!infile.good()) return;
+    WeightTable* weights = approximator.weight_table();
+    if (!weights) throw std::logic_error("Approximator has no weight table.");
+
+    DeltaHeader header;
+    infile.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!infile || std::memcmp(header.magic, DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0
+        || header.block_size != WeightTable::BLOCK_SIZE)
+        throw std::runtime_error("Not a checkpoint delta file: " + filename + ".delta");
+    // Deltas written before the last compaction are part of the base. The
+    // checksum in the header of the base saves reading the mapped weights.
+    if (!Checkpoint::detect(filename)
+        || header.base_checksum != Checkpoint::stored_checksum(filename))
+        return;
+
+    // A group is one delta, it is read and checked completely before any
+    // block is applied. A truncated or corrupt group ends the restore.
+    std::vector<uint64_t> group_blocks;
+    std::vector<std::size_t> group_offsets;
+    std::vector<uint32_t> encoded;
+    uint64_t blocks;
+    bool applied = false;
+    while (infile.read(reinterpret_cast<char*>(&blocks), sizeof(blocks))) {
+        if (blocks > weights->blocks()) break;
+        group_blocks.clear();
+        group_offsets.assign(1, 0);
+        encoded.clear();
+        bool valid = true;
+        for (uint64_t i = 0; valid && i < blocks; i++) {
+            uint64_t block;
+            uint32_t size;
+            infile.read(reinterpret_cast<char*>(&block), sizeof(block));
+            infile.read(reinterpret_cast<char*>(&size), sizeof(size));
+            valid = infile && block < weights->blocks() && size <= MAX_ENCODED_WORDS;
+            if (!valid) break;
+            const std::size_t offset = encoded.size();
+            encoded.resize(offset + size);
+            valid = infile.read(reinterpret_cast<char*>(encoded.data() + offset),
+                    size * sizeof(uint32_t))
+                && decode(encoded.data() + offset, size, nullptr,
+                    std::min(WeightTable::BLOCK_SIZE,
+                        weights->size() - block * WeightTable::BLOCK_SIZE));
+            group_blocks.push_back(block);
+            group_offsets.push_back(encoded.size());
+        }
+        if (!valid) break;
+
+        for (std::size_t i = 0; i < group_blocks.size(); i++) {
+            std::size_t first = group_blocks[i] * WeightTable::BLOCK_SIZE;
+            decode(encoded.data() + group_offsets[i],
+                group_offsets[i + 1] - group_offsets[i], weights->data() + first,
+                std::min(WeightTable::BLOCK_SIZE, weights->size() - first));
+        }
+        applied = applied || !group_blocks.empty();
+    }
+    if (!applied) return;
+    weights->mark_all_changed();
+    weights->sync_replicas();
+}
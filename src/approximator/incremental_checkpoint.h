@@ -0,0 +1,149 @@
+#ifndef __INCREMENTAL_CHECKPOINT_H_
+#define __INCREMENTAL_CHECKPOINT_H_
+
+#include "src/approximator/approximator.h"
+#include "src/approximator/checkpoint.h"
+#include "src/approximator/weight_table.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Writes checkpoints of an approximator incrementally on a background
+ *        thread. Only blocks of the weight table changed since the last
+ *        checkpoint are copied (the only stall of the caller) and appended to
+ *        a delta file, XOR-ed against the previous values and run-length
+ *        encoded. Every few checkpoints the base file is rewritten and the
+ *        deltas are dropped (compaction). The base is a regular checkpoint,
+ *        restore applies the deltas on top of it.
+ *
+ *        A copy of the weights of the last checkpoint is kept in memory, as
+ *        large as the table itself. Tables backed by a mapped file (which may
+ *        be larger than RAM) keep no copy: the file is their checkpoint, save
+ *        writes its modified pages back in the background and compact writes
+ *        the base from the live weights on the caller's thread.
+ */
+class IncrementalCheckpoint {
+  public:
+    /**
+     * @brief Construct a new incremental checkpoint and write the first base
+     *        in the background. Starts change tracking on the approximator.
+     *
+     * @param approximator Approximator with a weight table
+     * @param filename Base checkpoint, deltas go to filename + ".delta"
+     * @param compaction_interval Number of deltas between two bases
+     */
+    IncrementalCheckpoint(
+        const std::shared_ptr<Approximator>& approximator,
+        const std::string& filename,
+        int compaction_interval = 10);
+
+    /**
+     * @brief Waits for the background writer and stops change tracking
+     *
+     */
+    ~IncrementalCheckpoint();
+
+    /**
+     * @brief Takes a snapshot of the changed blocks and writes it as delta (or
+     *        as new base every compaction_interval calls) in the background.
+     *        Mapped tables are synced to their file instead. Learners must not
+     *        update the weights during the call.
+     *
+     */
+    void save();
+
+    /**
+     * @brief Like save, but always writes a new base.
+     *
+     */
+    void compact();
+
+    /**
+     * @brief Blocks until the background writer is idle. Rethrows an error
+     *        of the last write.
+     *
+     */
+    void wait();
+
+    /**
+     * @brief Get the number of bytes appended to the delta file by the last
+     *        delta
+     *
+     * @return std::size_t
+     */
+    std::size_t getDeltaBytes();
+
+    /**
+     * @brief Applies the deltas of a checkpoint to an approximator which has
+     *        loaded (or mapped) the base. Deltas which belong to another base
+     *        are ignored. A delta is applied completely or not at all, a
+     *        truncated or corrupt delta ends the restore.
+     *
+     * @param approximator Approximator with the loaded base
+     * @param filename Base checkpoint
+     */
+    static void restore(Approximator& approximator, const std::string& filename);
+
+  private:
+    /**
+     * @brief Snapshot which waits for the background writer
+     */
+    struct Job {
+        std::vector<std::size_t> blocks; //<! Changed blocks
+        std::vector<float> values;       //<! Weights of the changed blocks
+        bool compact = false;            //<! Write a new base
+    };
+
+    std::shared_ptr<Approximator> approximator; //<! Approximator to checkpoint
+    std::string filename;                       //<! Base checkpoint
+    int compaction_interval;                    //<! Number of deltas between two bases
+    int deltas;                                 //<! Deltas since the last base
+    Checkpoint description;                     //<! Layout of the weights
+    bool mapped;                                //<! Weights live in a mapped file, no deltas
+    int tracker;                                //<! Change tracker of the weights, -1 if mapped
+    WeightTable shadow;                         //<! Weights of the last checkpoint, empty if mapped
+    std::size_t delta_bytes;                    //<! Size of the last delta
+
+    std::mutex mutex;                   //<! Protects the following members
+    std::condition_variable condition;  //<! Signals new jobs and finished jobs
+    std::unique_ptr<Job> pending;       //<! Job for the background writer
+    bool busy;                          //<! Background writer works on a job
+    bool stop;                          //<! Background writer has to quit
+    std::string error;                  //<! Error message of the last job
+    std::thread writer;                 //<! Background writer
+
+    /**
+     * @brief Copies the changed blocks and hands them to the writer
+     *
+     * @param compact Write a new base
+     */
+    void submit(bool compact);
+
+    /**
+     * @brief Main loop of the background writer
+     *
+     */
+    void run();
+
+    /**
+     * @brief Appends the XOR-encoded blocks of a job to the delta file and
+     *        updates the shadow copy.
+     *
+     * @param job Snapshot
+     */
+    void write_delta(const Job& job);
+
+    /**
+     * @brief Writes a new base and starts an empty delta file
+     *
+     * @param weights Weights of the base, the shadow copy or the mapped table
+     */
+    void write_base(const WeightTable& weights);
+};
+
+#endif
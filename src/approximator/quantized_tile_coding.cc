@@ -0,0 +1,252 @@
+#include "src/approximator/quantized_tile_coding.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+// IEEE 754 half precision, round to nearest even
+uint16_t float_to_half(float value) {
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    const uint32_t sign = (x >> 16) & 0x8000;
+    const int32_t exponent = int32_t((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = x & 0x7fffff;
+    if (((x >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    if (exponent >= 31) return sign | 0x7c00;
+    if (exponent <= 0) {
+        // Subnormal half
+        if (exponent < -10) return sign;
+        mantissa |= 0x800000;
+        const uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t middle = 1u << (shift - 1);
+        if (rest > middle || (rest == middle && (half & 1))) half++;
+        return sign | half;
+    }
+    uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1fff;
+    // A carry into the exponent is the correct rounding
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return sign | half;
+}
+
+float half_to_float(uint16_t half) {
+    const uint32_t sign = uint32_t(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+    if (exponent == 0) {
+        float value = std::ldexp(float(mantissa), -24);
+        return sign ? -value : value;
+    }
+    uint32_t x = sign | (exponent == 31 ?
+        0x7f800000 | (mantissa << 13) : ((exponent + 112) << 23) | (mantissa << 13));
+    float value;
+    std::memcpy(&value, &x, sizeof(value));
+    return value;
+}
+}
+
+QuantizedTileCoding::QuantizedTileCoding(
+        const TileCoding& source, Precision precision)
+    : Approximator(source.number_of_actions, source.dimensions_of_statespace),
+      precision(precision),
+      tilings(source.tilings),
+      kernel(source.kernel) {
+    // Read-only weights need no locks
+    concurrency_mode = ConcurrencyMode::HOGWILD;
+    quantize(source.values.data(), source.tiling_offset, source.tiling_size,
+        source.action_kernel);
+}
+
+QuantizedTileCoding::QuantizedTileCoding(
+        const StateAggregation& source, Precision precision)
+    : Approximator(source.number_of_actions, source.dimensions_of_statespace),
+      precision(precision),
+      tilings(1) {
+    concurrency_mode = ConcurrencyMode::HOGWILD;
+    // A state aggregation is a tile coding with a single tiling
+    std::vector<TileAxis> axes;
+    for (int d=0; d < source.segments.size(); d++) {
+        TileAxis axis;
+        axis.dimension = d;
+        axis.min_value = source.min_values[d];
+        axis.scale = 1.0f / source.segment_size[d];
+        axis.segments = source.segments[d];
+        axes.push_back(axis);
+    }
+    std::vector<int> tiling_axes = {0, int(axes.size())};
+    std::vector<Eigen::Index> tiling_offset = {0};
+    std::vector<Eigen::Index> tiling_size = {
+        Eigen::Index(source.values.size() / number_of_actions)};
+    kernel = TileIndexKernel(axes, tiling_axes, tiling_offset, number_of_actions);
+    quantize(source.values.data(), tiling_offset, tiling_size, source.action_kernel);
+}
+
+void QuantizedTileCoding::quantize(const float* weights,
+        const std::vector<Eigen::Index>& tiling_offset,
+        const std::vector<Eigen::Index>& tiling_size,
+        const Eigen::VectorXf& action_kernel) {
+    const Eigen::Index size = tiling_offset.back()
+        + tiling_size.back() * number_of_actions;
+    if (precision == Precision::INT8) {
+        int8_values.resize(size);
+    } else {
+        fp16_values.resize(size);
+    }
+
+    std::vector<double> folded(number_of_actions);
+    scale.resize(tilings);
+    for (int t=0; t < tilings; t++) {
+        const float* first = weights + tiling_offset[t];
+        // Values with the action kernel applied, like the float prediction
+        auto fold = [&](Eigen::Index tile) {
+            const float* tile_values = first + tile * number_of_actions;
+            for (int action = 0; action < number_of_actions; action++) {
+                double tile_value = action_kernel[0] * tile_values[action];
+                for (int i=1; i < action_kernel.size(); i++) {
+                    int action_p = std::min(action + i, number_of_actions-1);
+                    int action_n = std::max(action - i, 0);
+                    tile_value += action_kernel[i] * tile_values[action_p]
+                        + action_kernel[i] * tile_values[action_n];
+                }
+                folded[action] = tile_value;
+            }
+        };
+
+        // Largest magnitude of the tiling defines its scale
+        double largest = 0.0;
+        for (Eigen::Index tile = 0; tile < tiling_size[t]; tile++) {
+            fold(tile);
+            for (double v : folded) largest = std::max(largest, std::abs(v));
+        }
+        if (largest == 0.0) largest = 1.0;
+        scale[t] = precision == Precision::INT8 ? largest / 127.0 : largest;
+
+        for (Eigen::Index tile = 0; tile < tiling_size[t]; tile++) {
+            fold(tile);
+            const Eigen::Index index = tiling_offset[t] + tile * number_of_actions;
+            for (int action = 0; action < number_of_actions; action++) {
+                const double normalized = folded[action] / scale[t];
+                if (precision == Precision::INT8) {
+                    int8_values[index + action] = int8_t(std::max(-127.0,
+                        std::min(127.0, std::round(normalized))));
+                } else {
+                    fp16_values[index + action] = float_to_half(float(normalized));
+                }
+            }
+        }
+    }
+}
+
+std::size_t QuantizedTileCoding::getMemorySize() const {
+    return int8_values.size() * sizeof(int8_t)
+        + fp16_values.size() * sizeof(uint16_t)
+        + scale.size() * sizeof(float);
+}
+
+void QuantizedTileCoding::save(std::string filename) {
+    std::ofstream outfile(filename, std::ios_base::binary);
+    if (outfile.is_open()) {
+        outfile.write(reinterpret_cast<const char*>(scale.data()),
+            static_cast<int64_t>(scale.size() * sizeof(float)));
+        outfile.write(reinterpret_cast<const char*>(int8_values.data()),
+            static_cast<int64_t>(int8_values.size() * sizeof(int8_t)));
+        outfile.write(reinterpret_cast<const char*>(fp16_values.data()),
+            static_cast<int64_t>(fp16_values.size() * sizeof(uint16_t)));
+        outfile.close();
+    }
+}
+
+void QuantizedTileCoding::load(std::string filename) {
+    std::ifstream infile(filename, std::ios_base::binary | std::ios_base::ate);
+    if (infile.good()) {
+        if (uint64_t(infile.tellg()) != getMemorySize())
+            throw std::runtime_error("File does not match the table size.");
+        infile.seekg(0);
+        infile.read(reinterpret_cast<char*>(scale.data()),
+            static_cast<int64_t>(scale.size() * sizeof(float)));
+        infile.read(reinterpret_cast<char*>(int8_values.data()),
+            static_cast<int64_t>(int8_values.size() * sizeof(int8_t)));
+        infile.read(reinterpret_cast<char*>(fp16_values.data()),
+            static_cast<int64_t>(fp16_values.size() * sizeof(uint16_t)));
+        infile.close();
+    }
+}
+
+double QuantizedTileCoding::greedy_agreement(Approximator& reference,
+        const Eigen::Ref<const Eigen::MatrixXd>& states) {
+    if (states.cols() == 0) return 1.0;
+    Eigen::Index agreeing = 0;
+    for (Eigen::Index i = 0; i < states.cols(); i++) {
+        if (reference.greedy_action(states.col(i)) == greedy_action(states.col(i)))
+            agreeing++;
+    }
+    return double(agreeing) / states.cols();
+}
+
+double QuantizedTileCoding::value(const Eigen::Index* offsets, int action) const {
+    double prediction = 0.0;
+    if (precision == Precision::INT8) {
+        for (int t=0; t < tilings; t++)
+            prediction += scale[t] * int8_values[offsets[t] + action];
+    } else {
+        for (int t=0; t < tilings; t++)
+            prediction += scale[t] * half_to_float(fp16_values[offsets[t] + action]);
+    }
+    return prediction;
+}
+
+double QuantizedTileCoding::predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        int action) {
+    Eigen::Index offsets[TileIndexKernel::MAX_TILINGS];
+    kernel.compute(state.data(), state.size(), 1, offsets);
+    return value(offsets, action);
+}
+
+Eigen::VectorXd QuantizedTileCoding::predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        const Eigen::Ref<const Eigen::VectorXi>& actions) {
+    Eigen::Index offsets[TileIndexKernel::MAX_TILINGS];
+    kernel.compute(state.data(), state.size(), 1, offsets);
+    Eigen::VectorXd prediction(actions.size());
+    for (int action_idx = 0; action_idx < actions.size(); action_idx++) {
+        prediction[action_idx] = value(offsets, actions[action_idx]);
+    }
+    return prediction;
+}
+
+void QuantizedTileCoding::predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) {
+    Eigen::Index offsets[TileIndexKernel::MAX_TILINGS];
+    kernel.compute(state.data(), state.size(), 1, offsets);
+    for (int action = 0; action < number_of_actions; action++) {
+        values_out[action] = value(offsets, action);
+    }
+}
+
+int QuantizedTileCoding::greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) {
+    Eigen::Index offsets[TileIndexKernel::MAX_TILINGS];
+    kernel.compute(state.data(), state.size(), 1, offsets);
+    int best_action = 0;
+    double best_value = 0.0;
+    for (int action = 0; action < number_of_actions; action++) {
+        double action_value = value(offsets, action);
+        if (action == 0 || action_value > best_value) {
+            best_action = action;
+            best_value = action_value;
+        }
+    }
+    return best_action;
+}
+
+double QuantizedTileCoding::update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target) {
+    throw std::logic_error("Quantized approximator is read-only.");
+}
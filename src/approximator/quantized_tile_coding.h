@@ -0,0 +1,120 @@
+#ifndef __QUANTIZED_TILE_CODING_H_
+#define __QUANTIZED_TILE_CODING_H_
+
+#include "src/approximator/approximator.h"
+#include "src/approximator/state_aggregation.h"
+#include "src/approximator/tile_coding.h"
+#include "src/approximator/tile_index_kernel.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Read-only copy of a trained TileCoding or StateAggregation with
+ *        quantized weights for inference. The action kernel is folded into
+ *        the weights, each tiling has its own scale factor. Predictions take
+ *        no locks, updates are not supported.
+ */
+class QuantizedTileCoding : public Approximator {
+  public:
+    /**
+     * @brief Storage type of the weights
+     */
+    enum class Precision {
+        INT8, //<! 8 bit integers, 4x smaller than float
+        FP16  //<! 16 bit floats, 2x smaller than float
+    };
+
+    /**
+     * @brief Construct a new quantized copy of a tile coding
+     *
+     * @param source Trained tile coding
+     * @param precision Storage type of the weights
+     */
+    QuantizedTileCoding(const TileCoding& source, Precision precision = Precision::INT8);
+
+    /**
+     * @brief Construct a new quantized copy of a state aggregation
+     *
+     * @param source Trained state aggregation
+     * @param precision Storage type of the weights
+     */
+    QuantizedTileCoding(const StateAggregation& source, Precision precision = Precision::INT8);
+
+    void save(std::string filename) override;
+
+    void load(std::string filename) override;
+
+    /**
+     * @brief Get the fraction of states for which this approximator and a
+     *        reference (e.g. the source) select the same greedy action.
+     *
+     * @param reference Approximator to compare with
+     * @param states State vectors, one column per state
+     * @return Greedy action agreement between 0 and 1
+     */
+    double greedy_agreement(Approximator& reference,
+        const Eigen::Ref<const Eigen::MatrixXd>& states);
+
+    /**
+     * @brief Get the memory used by the quantized weights
+     *
+     * @return Number of bytes
+     */
+    std::size_t getMemorySize() const;
+
+    Precision getPrecision() const { return precision; }
+
+  private:
+    Precision precision;              //<! Storage type of the weights
+    int tilings;                      //<! Number of tilings
+    TileIndexKernel kernel;           //<! Computes the active tiles
+    std::vector<float> scale;         //<! Scale factor of each tiling
+    std::vector<int8_t> int8_values;  //<! Weights for INT8
+    std::vector<uint16_t> fp16_values; //<! Weights for FP16 (IEEE half bits)
+
+    /**
+     * @brief Quantizes float weights, the values of an action include the
+     *        weighted neighbors according to the action kernel.
+     *
+     * @param weights Float weights in action-minor layout
+     * @param tiling_offset Start of each tiling
+     * @param tiling_size Number of tiles of each tiling
+     * @param action_kernel Influence of an action to its neighboring actions
+     */
+    void quantize(const float* weights,
+        const std::vector<Eigen::Index>& tiling_offset,
+        const std::vector<Eigen::Index>& tiling_size,
+        const Eigen::VectorXf& action_kernel);
+
+    /**
+     * @brief Sums the dequantized values of the active tiles for one action.
+     *
+     * @param offsets Active tile of each tiling
+     * @param action Action value
+     * @return State-action value
+     */
+    double value(const Eigen::Index* offsets, int action) const;
+
+  protected:
+    double predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        int action) override;
+
+    Eigen::VectorXd predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        const Eigen::Ref<const Eigen::VectorXi>& actions) override;
+
+    void predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) override;
+
+    int greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) override;
+
+    double update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target) override;
+};
+
+#endif
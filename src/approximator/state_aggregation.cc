@@ -1,5 +1,7 @@
 #include "src/approximator/state_aggregation.h"
+#include <algorithm>
 #include <fstream>
+#include <limits>
 
 StateAggregation::StateAggregation(
         int number_of_actions,
@@ -9,7 +11,8 @@ StateAggregation::StateAggregation(
         const Eigen::Ref<const Eigen::VectorXf> &min_values,
         const Eigen::Ref<const Eigen::VectorXf> &max_values,
         const Eigen::Ref<const Eigen::VectorXf> &action_kernel,
-        double init_min_value, double init_max_value)
+        double init_min_value, double init_max_value,
+        const std::string &weight_file)
         : Approximator(
             number_of_actions,
             dimensions_of_statespace),
@@ -24,95 +27,186 @@ StateAggregation::StateAggregation(
     // How big is each segment
     segment_size = size_statespace.array() / segments.cast<float>().array();
     
-    // Reserve enough memory
-    values = (Eigen::VectorXf::Random(
-        segments.prod() * number_of_actions).array() + 1.0) / 2.0
-        * (init_max_value - init_min_value) + init_min_value;
+    // Reserve enough memory, 64 bit arithmetic avoids silent overflows
+    Eigen::Index size = number_of_actions;
+    for (int i=0; i < segments.size(); i++) {
+        if (size > std::numeric_limits<Eigen::Index>::max() / segments[i])
+            throw std::overflow_error("State-action table is too large.");
+        size *= segments[i];
+    }
+    values = weight_file.empty() ? WeightTable(size) :
+        WeightTable(size, weight_file, checkpoint().describe(size));
+    // A new mapped file is already zero
+    if (!values.isRestored()
+        && (init_min_value != 0 || init_max_value != 0 || !values.isMapped())) {
+        values.vector() = (Eigen::VectorXf::Random(size).array() + 1.0) / 2.0
+            * (init_max_value - init_min_value) + init_min_value;
+    }
 }
 
 Eigen::Ref<Eigen::VectorXf> StateAggregation::getValues() {
-    return values;
+    return values.vector();
 }
 
-void StateAggregation::save(std::string filename) {
-    std::ofstream outfile(filename, std::ios_base::binary);
-    if (outfile.is_open()) {
-        outfile.write(
-            reinterpret_cast<const char*>(values.data()),
-            static_cast<int64_t>(
-                values.size() * sizeof(values.data()[0])));
-        outfile.close();
+Checkpoint StateAggregation::checkpoint() const {
+    Checkpoint description(
+        "StateAggregation", number_of_actions, dimensions_of_statespace);
+    for (int i=0; i < segments.size(); i++) {
+        description.add(int64_t(segments[i]));
+        description.add(min_values[i]);
+        description.add(max_values[i]);
     }
+    return description;
+}
+
+void StateAggregation::save(std::string filename) {
+    checkpoint().save(filename, values);
 }
 
 void StateAggregation::load(std::string filename) {
-    std::ifstream infile(filename, std::ios_base::binary);
+    if (Checkpoint::detect(filename)) {
+        checkpoint().load(filename, values);
+        values.sync_replicas();
+        return;
+    }
+    // Files without header keep the action-major layout
+    std::ifstream infile(filename, std::ios_base::binary | std::ios_base::ate);
     if (infile.good()) {
-        infile.read(
-            reinterpret_cast<char*>(values.data()),
-            static_cast<int64_t>(
-                values.size() * sizeof(values.data()[0])));
+        if (uint64_t(infile.tellg()) != values.size() * sizeof(float))
+            throw std::runtime_error("File does not match the table size.");
+        infile.seekg(0);
+        values.read_action_major(
+            infile, 0, values.size() / number_of_actions, number_of_actions);
         infile.close();
+        values.sync_replicas();
     }
 }
 
-double StateAggregation::predict_implementation(
-        Eigen::Ref<const Eigen::VectorXd> state,
-        int action) {
-    Eigen::VectorXi indices = get_indices(state);
-    double prediction = action_kernel[0] * values[indices[action]];
+void StateAggregation::map(std::string filename) {
+    if (Checkpoint::detect(filename)) {
+        values = checkpoint().map(filename, values.size());
+    } else {
+        load(filename);
+    }
+}
+
+double StateAggregation::value(
+        const float* weights, Eigen::Index index, int action) const {
+    const float* state_values = weights + index;
+    // Action-kernel defines the influence of "neigboring" actions
+    double prediction = action_kernel[0] * state_values[action];
     for (int i=1; i < action_kernel.size(); i++) {
        int action_p = std::min(action + i, number_of_actions-1);
        int action_n = std::max(action - i, 0);
-       prediction += action_kernel[i] * values[indices[action_p]]
-           + action_kernel[i] * values[indices[action_n]];
+       prediction += action_kernel[i] * state_values[action_p]
+           + action_kernel[i] * state_values[action_n];
+    }
+    return prediction;
+}
+
+double StateAggregation::predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        int action) {
+    return value(values.local_data(), get_index(state), action);
+}
+
+Eigen::VectorXd StateAggregation::predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        const Eigen::Ref<const Eigen::VectorXi>& actions) {
+    // Index is shared by all actions
+    Eigen::Index index = get_index(state);
+    Eigen::VectorXd prediction(actions.size());
+    for (int action_idx = 0; action_idx < actions.size(); action_idx++) {
+        int action = actions[action_idx];
+        lock_action(action);
+        prediction[action_idx] = value(values.local_data(), index, action);
+        unlock_action(action);
     }
     return prediction;
 }
 
+void StateAggregation::predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) {
+    Eigen::Index index = get_index(state);
+    for (int action = 0; action < number_of_actions; action++) {
+        lock_action(action);
+        values_out[action] = value(values.local_data(), index, action);
+        unlock_action(action);
+    }
+}
+
+int StateAggregation::greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) {
+    Eigen::Index index = get_index(state);
+    int best_action = 0;
+    double best_value = 0.0;
+    for (int action = 0; action < number_of_actions; action++) {
+        lock_action(action);
+        double action_value = value(values.local_data(), index, action);
+        unlock_action(action);
+        if (action == 0 || action_value > best_value) {
+            best_action = action;
+            best_value = action_value;
+        }
+    }
+    return best_action;
+}
+
 double StateAggregation::update_implementation(
         const Eigen::Ref<const Eigen::VectorXd>& state,
         int action,
         double target) {
-    // Indices is a vector of form [idx(state,a=0), idx(state,a=1), ..., idx(state,a=A)]
-    Eigen::VectorXi indices = get_indices(state);
-    // Predict value (action-kernel defines the influence of "neigboring" actions)
-    double prediction = action_kernel[0] * values[indices[action]];
-    for (int i=1; i < action_kernel.size(); i++) {
-       int action_p = std::min(action + i, number_of_actions-1);
-       int action_n = std::max(action - i, 0);
-       prediction += action_kernel[i] * values[indices[action_p]]
-          + action_kernel[i] * values[indices[action_n]];
-    }
+    // Values of all actions of the state start at index
+    Eigen::Index index = get_index(state);
     // Calculate error
-    double prediction_error = target - prediction;
+    double prediction_error = target - value(values.data(), index, action);
     // Update values
-    values[indices[action]] += action_kernel[0] * prediction_error * step_size;
+    float* state_values = values.data() + index;
+    add_weight(&state_values[action],
+        action_kernel[0] * prediction_error * step_size);
     for (int i=1; i < action_kernel.size(); i++) {
        int action_p = std::min(action + i, number_of_actions-1);
        int action_n = std::max(action - i, 0);
-       values[indices[action_p]] += 
-           action_kernel[i] * prediction_error * step_size;
-       values[indices[action_n]] += 
-           action_kernel[i] * prediction_error * step_size;
+       add_weight(&state_values[action_p],
+           action_kernel[i] * prediction_error * step_size);
+       add_weight(&state_values[action_n],
+           action_kernel[i] * prediction_error * step_size);
     }
 
     return prediction_error;
 }
 
-Eigen::VectorXi StateAggregation::get_indices(Eigen::VectorXd state) {
-    Eigen::VectorXi indices_out = Eigen::VectorXi::Zero(number_of_actions);
+int StateAggregation::features(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        Eigen::Index* indices_out,
+        double* values_out) {
+    Eigen::Index index = get_index(state);
+    int count = 0;
+    indices_out[count] = index + action;
+    values_out[count++] = action_kernel[0];
+    for (int i=1; i < action_kernel.size(); i++) {
+        int action_p = std::min(action + i, number_of_actions-1);
+        int action_n = std::max(action - i, 0);
+        indices_out[count] = index + action_p;
+        values_out[count++] = action_kernel[i];
+        indices_out[count] = index + action_n;
+        values_out[count++] = action_kernel[i];
+    }
+    return count;
+}
+
+Eigen::Index StateAggregation::get_index(
+        const Eigen::Ref<const Eigen::VectorXd>& state) const {
     Eigen::VectorXf state_shifted = state.cast<float>() - min_values;
     Eigen::VectorXi indices = (state_shifted.array() / segment_size.array()).cast<int>();
     indices = indices.array().min(segments.array() - 1);
-    unsigned int index = indices[0];
+    Eigen::Index index = indices[0];
     for (int i=1; i < indices.size(); i++) {
         index *= segments[i];
         index += indices[i];
     }
-    // Also include action
-    for (int i=0; i < number_of_actions; i++) {
-        indices_out.coeffRef(i) = index + i*segments.prod();
-    }
-    return indices_out;
-}
\ No newline at end of file
+    // Actions of a state are stored next to each other
+    return index * number_of_actions;
+}
@@ -2,8 +2,12 @@
 #define __STATE_AGGREGATION_H_
 
 #include "src/approximator/approximator.h"
+#include "src/approximator/checkpoint.h"
+#include "src/approximator/weight_table.h"
 
 class StateAggregation : public Approximator {
+    friend class QuantizedTileCoding; //<! Reads the trained weights
+
   public:
     double step_size; //<! How much the updates affect the values
 
@@ -19,6 +23,7 @@ class StateAggregation : public Approximator {
      * @param action_kernel Defines the influence of an action to its neighboring actions
      * @param init_min_value Minimum value for random initialization
      * @param init_max_value Maximum value for random initialization
+     * @param weight_file Keeps the values in this memory-mapped file if not empty
      */
     StateAggregation(
         int number_of_actions,
@@ -28,35 +33,74 @@ class StateAggregation : public Approximator {
         const Eigen::Ref<const Eigen::VectorXf> &min_values,
         const Eigen::Ref<const Eigen::VectorXf> &max_values,
         const Eigen::Ref<const Eigen::VectorXf> &action_kernel = (Eigen::Matrix<float, 1, 1>()<< 1.0).finished(),
-        double init_min_value = 0.0, double init_max_value = 0.0);
+        double init_min_value = 0.0, double init_max_value = 0.0,
+        const std::string &weight_file = "");
 
     void save(std::string filename);
 
     void load(std::string filename);
 
+    void map(std::string filename) override;
+
+    WeightTable* weight_table() override { return &values; }
+
+    Checkpoint checkpoint() const override;
+
+    int features(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        Eigen::Index* indices_out,
+        double* values_out) override;
+
+    int max_features() const override { return 2 * int(action_kernel.size()) - 1; }
+
+    double feature_step_size() const override { return step_size; }
+
     Eigen::Ref<Eigen::VectorXf> getValues();
 
   private:
     Eigen::VectorXf action_kernel;
-    Eigen::VectorXf values;       //<! Storage for state-action values
+    WeightTable values;           //<! Storage for state-action values, actions of a state are adjacent
     Eigen::VectorXi segments;     //<! Number of segments for each state dimension
     Eigen::VectorXf segment_size; //<! Size of each segment in state-space
     Eigen::VectorXf min_values;   //<! Minimum state-space values
     Eigen::VectorXf max_values;   //<! Maximum state-space values
 
     /**
-     * @brief Get the indices of the state-action values for all possible actions.
+     * @brief Get the index of the first action's value for the given state.
+     *        The values of all actions follow at consecutive indices.
      * 
      * @param state State vector
-     * @return Indices for state-action values
+     * @return Index of the state-action value for action 0
      */
-    Eigen::VectorXi get_indices(Eigen::VectorXd state);
+    Eigen::Index get_index(const Eigen::Ref<const Eigen::VectorXd>& state) const;
+
+    /**
+     * @brief Predicts the value of an action at the given index.
+     * 
+     * @param weights Weights to read, the primary table or a local replica
+     * @param index Index of the state-action value for action 0
+     * @param action Action value
+     * @return State-action value
+     */
+    double value(const float* weights, Eigen::Index index, int action) const;
 
   protected:
     double predict_implementation(
         Eigen::Ref<const Eigen::VectorXd> state,
         int action) override;
 
+    Eigen::VectorXd predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        const Eigen::Ref<const Eigen::VectorXi>& actions) override;
+
+    void predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) override;
+
+    int greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) override;
+
     double update_implementation(
         const Eigen::Ref<const Eigen::VectorXd>& state,
         int action,
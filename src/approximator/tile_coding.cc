@@ -1,5 +1,23 @@
 #include "src/approximator/tile_coding.h"
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <limits>
+
+namespace {
+// One group which covers all dimensions
+std::vector<TilingGroup> full_group(
+        int dimensions, int tilings,
+        const Eigen::Ref<const Eigen::VectorXi> &displacement,
+        const Eigen::Ref<const Eigen::VectorXi> &segments) {
+    TilingGroup group;
+    for (int d=0; d < dimensions; d++) group.dimensions.push_back(d);
+    group.tilings = tilings;
+    group.segments = segments;
+    group.displacement = displacement;
+    return {group};
+}
+}
 
 TileCoding::TileCoding(
     int number_of_actions,
@@ -11,85 +29,327 @@ TileCoding::TileCoding(
     const Eigen::Ref<const Eigen::VectorXf> &min_values,
     const Eigen::Ref<const Eigen::VectorXf> &max_values,
     const Eigen::Ref<const Eigen::VectorXf> &action_kernel,
-    double init_min_value, double init_max_value)
-  : Approximator(number_of_actions, dimensions_of_statespace) {
-      // How big is each dimension
-      auto size_statespace = max_values - min_values;
-
-      // How big is each segment
-      auto segment_size = size_statespace.array() / segments.cast<float>().array();
-      
-      // How big is a "fundamental" tile
-      auto tile_size = segment_size.array() / float(tilings);
-
-      for (int i=0; i < tilings; i++) {
-
-          auto offset = tile_size.array() * displacement.cast<float>().array() * float(i);
-          auto layer_min_values = min_values.array() - offset.array();
-          auto layer_segments = segments.cast<float>().array() + (offset.array() / segment_size.array()).ceil();
-          auto layer_max_values = layer_min_values.array() + segment_size.array() * layer_segments.array();
-
-          layers.push_back(StateAggregation(
-              number_of_actions,
-              dimensions_of_statespace,
-              step_size / tilings,
-              layer_segments.cast<int>(),
-              layer_min_values,
-              layer_max_values,
-              action_kernel,
-              init_min_value / tilings, 
-              init_max_value / tilings
-          ));
+    double init_min_value, double init_max_value,
+    const std::string &weight_file)
+  : TileCoding(number_of_actions, dimensions_of_statespace, step_size,
+        full_group(dimensions_of_statespace, tilings, displacement, segments),
+        min_values, max_values, action_kernel, init_min_value, init_max_value,
+        weight_file) {
+}
+
+TileCoding::TileCoding(
+    int number_of_actions,
+    int dimensions_of_statespace,
+    double step_size,
+    const std::vector<TilingGroup> &groups,
+    const Eigen::Ref<const Eigen::VectorXf> &min_values,
+    const Eigen::Ref<const Eigen::VectorXf> &max_values,
+    const Eigen::Ref<const Eigen::VectorXf> &action_kernel,
+    double init_min_value, double init_max_value,
+    const std::string &weight_file)
+  : Approximator(number_of_actions, dimensions_of_statespace),
+    step_size(step_size),
+    tilings(0),
+    action_kernel(action_kernel) {
+      if (min_values.size() != dimensions_of_statespace
+          || max_values.size() != dimensions_of_statespace)
+          throw std::invalid_argument("State-space bounds have wrong size.");
+
+      Eigen::Index table_size = 0;
+      for (const auto& group: groups) {
+          const int group_dims = group.dimensions.size();
+          if (group.segments.size() != group_dims
+              || group.displacement.size() != group_dims)
+              throw std::invalid_argument("Tiling group has wrong size.");
+          if (group.tilings < 1)
+              throw std::invalid_argument("Tiling group has no tilings.");
+
+          for (int i=0; i < group.tilings; i++) {
+              tiling_axes.push_back(axes.size());
+              Eigen::Index size = 1;
+              for (int k=0; k < group_dims; k++) {
+                  int d = group.dimensions[k];
+                  if (d < 0 || d >= dimensions_of_statespace)
+                      throw std::invalid_argument("Tiling group has illegal dimension.");
+                  // How big is each segment
+                  float segment_size = (max_values[d] - min_values[d]) / float(group.segments[k]);
+                  // How big is a "fundamental" tile
+                  float tile_size = segment_size / float(group.tilings);
+                  float offset = tile_size * float(group.displacement[k]) * float(i);
+
+                  TileAxis axis;
+                  axis.dimension = d;
+                  axis.min_value = min_values[d] - offset;
+                  axis.scale = 1.0f / segment_size;
+                  axis.segments = group.segments[k] + int(std::ceil(offset / segment_size));
+                  axes.push_back(axis);
+                  // 64 bit arithmetic avoids silent overflows
+                  if (size > std::numeric_limits<Eigen::Index>::max()
+                      / number_of_actions / axis.segments)
+                      throw std::overflow_error("Tiling is too large.");
+                  size *= axis.segments;
+              }
+              // Each tiling stores all actions of one state-space region
+              tiling_offset.push_back(table_size);
+              tiling_size.push_back(size);
+              if (table_size > std::numeric_limits<Eigen::Index>::max()
+                  - size * number_of_actions)
+                  throw std::overflow_error("Weight table is too large.");
+              table_size += size * number_of_actions;
+              tilings++;
+          }
+      }
+      tiling_axes.push_back(axes.size());
+      if (tilings < 1 || tilings > MAX_TILINGS)
+          throw std::invalid_argument("Number of tilings is out of range.");
+      kernel = TileIndexKernel(axes, tiling_axes, tiling_offset, number_of_actions);
+
+      // Reserve enough memory, each tile contributes a fraction of the value
+      init_min_value /= tilings;
+      init_max_value /= tilings;
+      values = weight_file.empty() ? WeightTable(table_size) :
+          WeightTable(table_size, weight_file, checkpoint().describe(table_size));
+      // A new mapped file is already zero
+      if (!values.isRestored()
+          && (init_min_value != 0 || init_max_value != 0 || !values.isMapped())) {
+          values.vector() = (Eigen::VectorXf::Random(table_size).array() + 1.0) / 2.0
+              * (init_max_value - init_min_value) + init_min_value;
       }
 }
 
-void TileCoding::save(std::string filename) {
-    std::ofstream outfile(filename, std::ios_base::binary);
-    if (outfile.is_open()) {
-        for (auto& layer: layers) {
-            auto* data = layer.getValues().data();
-            auto data_size = layer.getValues().size();
-            outfile.write(
-                reinterpret_cast<const char*>(data),
-                static_cast<int64_t>(data_size * sizeof(data[0])));
+Checkpoint TileCoding::checkpoint() const {
+    Checkpoint description("TileCoding", number_of_actions, dimensions_of_statespace);
+    description.add(int64_t(tilings));
+    for (int t=0; t < tilings; t++) {
+        description.add(int64_t(tiling_axes[t+1] - tiling_axes[t]));
+        for (int k=tiling_axes[t]; k < tiling_axes[t+1]; k++) {
+            description.add(int64_t(axes[k].dimension));
+            description.add(axes[k].min_value);
+            description.add(axes[k].scale);
+            description.add(int64_t(axes[k].segments));
         }
-        outfile.close();
     }
+    return description;
+}
+
+void TileCoding::save(std::string filename) {
+    checkpoint().save(filename, values);
 }
 
 void TileCoding::load(std::string filename) {
-    std::ifstream infile(filename, std::ios_base::binary);
+    if (Checkpoint::detect(filename)) {
+        checkpoint().load(filename, values);
+        values.sync_replicas();
+        return;
+    }
+    // Files without header keep the action-major layout of each tiling
+    std::ifstream infile(filename, std::ios_base::binary | std::ios_base::ate);
     if (infile.good()) {
-        for (auto& layer: layers) {
-            auto* data = layer.getValues().data();
-            auto data_size = layer.getValues().size();
-            infile.read(
-                reinterpret_cast<char*>(data),
-                static_cast<int64_t>(data_size * sizeof(data[0])));
+        if (uint64_t(infile.tellg()) != values.size() * sizeof(float))
+            throw std::runtime_error("File does not match the table size.");
+        infile.seekg(0);
+        for (int t=0; t < tilings; t++) {
+            values.read_action_major(
+                infile, tiling_offset[t], tiling_size[t], number_of_actions);
         }
         infile.close();
+        values.sync_replicas();
+    }
+}
+
+void TileCoding::map(std::string filename) {
+    if (Checkpoint::detect(filename)) {
+        values = checkpoint().map(filename, values.size());
+    } else {
+        load(filename);
+    }
+}
+
+void TileCoding::get_offsets(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Index* offsets_out) const {
+    kernel.compute(state.data(), state.size(), 1, offsets_out);
+}
+
+double TileCoding::value(
+        const float* weights, const Eigen::Index* offsets, int action) const {
+    double prediction = 0.0;
+    for (int t=0; t < tilings; t++) {
+        const float* tile = weights + offsets[t];
+        // Action-kernel defines the influence of "neigboring" actions
+        double tile_value = action_kernel[0] * tile[action];
+        for (int i=1; i < action_kernel.size(); i++) {
+            int action_p = std::min(action + i, number_of_actions-1);
+            int action_n = std::max(action - i, 0);
+            tile_value += action_kernel[i] * tile[action_p]
+                + action_kernel[i] * tile[action_n];
+        }
+        prediction += tile_value;
     }
+    return prediction;
 }
 
-Eigen::VectorXd TileCoding::predict(
-      const Eigen::Ref<const Eigen::VectorXd>& state,
-      const Eigen::Ref<const Eigen::VectorXi>& actions) {
-    Eigen::VectorXd prediction = Eigen::VectorXd::Zero(actions.size());
-    for(auto& layer: layers) {
-        Eigen::VectorXd layer_prediction = layer.predict(state,actions) / layers.size();
-        prediction = prediction + layer_prediction;
+double TileCoding::predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        int action) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets);
+    return value(values.local_data(), offsets, action);
+}
+
+Eigen::VectorXd TileCoding::predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        const Eigen::Ref<const Eigen::VectorXi>& actions) {
+    // Tile indices are shared by all actions
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets);
+
+    Eigen::VectorXd prediction(actions.size());
+    for (int action_idx = 0; action_idx < actions.size(); action_idx++) {
+        int action = actions[action_idx];
+        lock_action(action);
+        prediction[action_idx] = value(values.local_data(), offsets, action);
+        unlock_action(action);
     }
     return prediction;
 }
-    
-double TileCoding::update(
-      const Eigen::Ref<const Eigen::VectorXd>& state,
-      const int action,
-      double target) {
-    double td_error = 0.0;
-    for(auto& layer: layers) {
-        double layer_error = layer.update(state, action, target) / layers.size();
-        td_error = td_error + layer_error;
+
+void TileCoding::predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets);
+    for (int action = 0; action < number_of_actions; action++) {
+        lock_action(action);
+        values_out[action] = value(values.local_data(), offsets, action);
+        unlock_action(action);
+    }
+}
+
+int TileCoding::greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets);
+    int best_action = 0;
+    double best_value = 0.0;
+    for (int action = 0; action < number_of_actions; action++) {
+        lock_action(action);
+        double action_value = value(values.local_data(), offsets, action);
+        unlock_action(action);
+        if (action == 0 || action_value > best_value) {
+            best_action = action;
+            best_value = action_value;
+        }
+    }
+    return best_action;
+}
+
+double TileCoding::update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets);
+    return update_tiles(offsets, action, target);
+}
+
+double TileCoding::weighted_update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target,
+        double weight) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets);
+    return update_tiles(offsets, action, target, weight);
+}
+
+double TileCoding::update_tiles(
+        const Eigen::Index* offsets, int action, double target, double weight) {
+    // One prediction over all tilings and one shared error
+    double prediction_error = target - value(values.data(), offsets, action);
+    // Gradient of the linear approximation spreads the error over all active tiles
+    double delta = weight * prediction_error * step_size / tilings;
+    for (int t=0; t < tilings; t++) {
+        float* tile = values.data() + offsets[t];
+        add_weight(&tile[action], action_kernel[0] * delta);
+        for (int i=1; i < action_kernel.size(); i++) {
+            int action_p = std::min(action + i, number_of_actions-1);
+            int action_n = std::max(action - i, 0);
+            add_weight(&tile[action_p], action_kernel[i] * delta);
+            add_weight(&tile[action_n], action_kernel[i] * delta);
+        }
+    }
+    return prediction_error;
+}
+
+int TileCoding::features(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        Eigen::Index* indices_out,
+        double* values_out) {
+    Eigen::Index offsets[MAX_TILINGS];
+    get_offsets(state, offsets);
+    // Same weights and factors as the prediction
+    int count = 0;
+    for (int t=0; t < tilings; t++) {
+        indices_out[count] = offsets[t] + action;
+        values_out[count++] = action_kernel[0];
+        for (int i=1; i < action_kernel.size(); i++) {
+            int action_p = std::min(action + i, number_of_actions-1);
+            int action_n = std::max(action - i, 0);
+            indices_out[count] = offsets[t] + action_p;
+            values_out[count++] = action_kernel[i];
+            indices_out[count] = offsets[t] + action_n;
+            values_out[count++] = action_kernel[i];
+        }
+    }
+    return count;
+}
+
+void TileCoding::prefetch_tiles(const Eigen::Index* offsets) const {
+    for (int t=0; t < tilings; t++) {
+        __builtin_prefetch(values.data() + offsets[t]);
+    }
+}
+
+void TileCoding::predict_batch_implementation(
+        const Eigen::Ref<const Eigen::MatrixXd>& states,
+        const Eigen::Ref<const Eigen::VectorXi>& actions,
+        Eigen::Ref<Eigen::VectorXd> values_out) {
+    Eigen::Index offsets[BATCH_CHUNK * MAX_TILINGS];
+    const float* weights = values.local_data();
+    for (Eigen::Index first = 0; first < states.cols(); first += BATCH_CHUNK) {
+        int count = std::min<Eigen::Index>(BATCH_CHUNK, states.cols() - first);
+        kernel.compute(states.col(first).data(), states.outerStride(), count, offsets);
+        for (int i=0; i < count; i++) {
+            // Tiles of the next state load while this one is summed
+            if (i + 1 < count) prefetch_tiles(offsets + (i+1) * tilings);
+            int action = actions[first + i];
+            lock_action(action);
+            values_out[first + i] = value(weights, offsets + i * tilings, action);
+            unlock_action(action);
+        }
+    }
+}
+
+void TileCoding::update_batch_implementation(
+        const Eigen::Ref<const Eigen::MatrixXd>& states,
+        const Eigen::Ref<const Eigen::VectorXi>& actions,
+        const Eigen::Ref<const Eigen::VectorXd>& targets,
+        Eigen::Ref<Eigen::VectorXd> errors_out) {
+    // Tile indices do not depend on the weights, so computing them ahead
+    // keeps the sequential semantics of single updates
+    Eigen::Index offsets[BATCH_CHUNK * MAX_TILINGS];
+    for (Eigen::Index first = 0; first < states.cols(); first += BATCH_CHUNK) {
+        int count = std::min<Eigen::Index>(BATCH_CHUNK, states.cols() - first);
+        kernel.compute(states.col(first).data(), states.outerStride(), count, offsets);
+        for (int i=0; i < count; i++) {
+            if (i + 1 < count) prefetch_tiles(offsets + (i+1) * tilings);
+            int action = actions[first + i];
+            lock_action(action);
+            errors_out[first + i] = update_tiles(
+                offsets + i * tilings, action, targets[first + i]);
+            unlock_action(action);
+        }
     }
-    return td_error;
-}
\ No newline at end of file
+}
@@ -1,15 +1,39 @@
 #ifndef __TILE_CODING_H_
 #define __TILE_CODING_H_
 
-#include "src/approximator/state_aggregation.h"
+#include "src/approximator/approximator.h"
+#include "src/approximator/checkpoint.h"
+#include "src/approximator/tile_index_kernel.h"
+#include "src/approximator/weight_table.h"
+#include <vector>
 
+/**
+ * @brief Group of tilings which covers a subset of the state dimensions.
+ */
+struct TilingGroup {
+    std::vector<int> dimensions;  //<! State dimensions covered by the group
+    int tilings;                  //<! Number of tilings in the group
+    Eigen::VectorXi segments;     //<! Number of segments for each covered dimension
+    Eigen::VectorXi displacement; //<! Displacement vector for each covered dimension
+};
+
+/**
+ * @brief Tile coding with all tilings fused into one weight table. The value
+ *        of a state-action pair is the sum over the active tile of each tiling.
+ *        The values of all actions of a tile are stored next to each other.
+ */
 class TileCoding : public Approximator {
+    friend class QuantizedTileCoding; //<! Reads the trained weights
+
   public:
+    static constexpr int MAX_TILINGS = TileIndexKernel::MAX_TILINGS; //<! Upper bound for the number of tilings
+    static constexpr int BATCH_CHUNK = 16; //<! States whose tile indices are computed together
+
     double step_size; //<! How much the updates affect the values
-    
+
     /**
      * @brief Construct a new Tile coding object
-     * 
+     *
      * @param number_of_actions Number of discrete actions
      * @param dimensions_of_statespace Size of state-space vector
      * @param step_size Step size, also called learning rate
@@ -21,6 +45,7 @@ class TileCoding : public Approximator {
      * @param action_kernel Defines the influence of an action to its neighboring actions
      * @param init_min_value Minimum value for random initialization
      * @param init_max_value Maximum value for random initialization
+     * @param weight_file Keeps the values in this memory-mapped file if not empty
      */
     TileCoding(
         int number_of_actions,
@@ -32,23 +57,144 @@ class TileCoding : public Approximator {
         const Eigen::Ref<const Eigen::VectorXf> &min_values,
         const Eigen::Ref<const Eigen::VectorXf> &max_values,
         const Eigen::Ref<const Eigen::VectorXf> &action_kernel = (Eigen::Matrix<float, 1, 1>()<< 1.0).finished(),
-        double init_min_value = 0.0, double init_max_value = 0.0);
-    
+        double init_min_value = 0.0, double init_max_value = 0.0,
+        const std::string &weight_file = "");
+
+    /**
+     * @brief Construct a new Tile coding object from groups of tilings. Each
+     *        group only tiles a subset of the state dimensions, the values of
+     *        all groups are summed.
+     *
+     * @param number_of_actions Number of discrete actions
+     * @param dimensions_of_statespace Size of state-space vector
+     * @param step_size Step size, also called learning rate
+     * @param groups Tiling groups
+     * @param min_values Minimum values of state-space (all dimensions)
+     * @param max_values Maximum values of state-space (all dimensions)
+     * @param action_kernel Defines the influence of an action to its neighboring actions
+     * @param init_min_value Minimum value for random initialization
+     * @param init_max_value Maximum value for random initialization
+     * @param weight_file Keeps the values in this memory-mapped file if not empty
+     */
+    TileCoding(
+        int number_of_actions,
+        int dimensions_of_statespace,
+        double step_size,
+        const std::vector<TilingGroup> &groups,
+        const Eigen::Ref<const Eigen::VectorXf> &min_values,
+        const Eigen::Ref<const Eigen::VectorXf> &max_values,
+        const Eigen::Ref<const Eigen::VectorXf> &action_kernel = (Eigen::Matrix<float, 1, 1>()<< 1.0).finished(),
+        double init_min_value = 0.0, double init_max_value = 0.0,
+        const std::string &weight_file = "");
+
     void save(std::string filename) override;
 
     void load(std::string filename) override;
 
-    Eigen::VectorXd predict(
-      const Eigen::Ref<const Eigen::VectorXd>& state,
-      const Eigen::Ref<const Eigen::VectorXi>& actions) override;
-    
-    double update(
-      const Eigen::Ref<const Eigen::VectorXd>& state,
-      const int action,
-      double target) override;
-  
+    void map(std::string filename) override;
+
+    WeightTable* weight_table() override { return &values; }
+
+    Checkpoint checkpoint() const override;
+
+    int features(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        Eigen::Index* indices_out,
+        double* values_out) override;
+
+    int max_features() const override {
+        return tilings * (2 * int(action_kernel.size()) - 1);
+    }
+
+    double feature_step_size() const override { return step_size / tilings; }
+
   private:
-    std::vector<StateAggregation> layers;
+    int tilings;                             //<! Number of tilings (of all groups)
+    Eigen::VectorXf action_kernel;           //<! Influence of an action to its neighboring actions
+    std::vector<TileAxis> axes;              //<! Axes of all tilings, stored tiling after tiling
+    std::vector<int> tiling_axes;            //<! First axis of each tiling (plus end marker)
+    std::vector<Eigen::Index> tiling_offset; //<! Start of each tiling in the weight table
+    std::vector<Eigen::Index> tiling_size;   //<! Number of states covered by each tiling
+    TileIndexKernel kernel;                  //<! Computes the active tiles
+    WeightTable values;                      //<! State-action values of all tilings
+
+    /**
+     * @brief Get the index of the active tile's first action in every tiling.
+     *
+     * @param state State vector
+     * @param offsets_out Output of one weight index per tiling
+     */
+    void get_offsets(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Index* offsets_out) const;
+
+    /**
+     * @brief Sums the values of the active tiles for one action.
+     *
+     * @param weights Weights to read, the primary table or a local replica
+     * @param offsets Active tile of each tiling
+     * @param action Action value
+     * @return State-action value
+     */
+    double value(const float* weights, const Eigen::Index* offsets, int action) const;
+
+    /**
+     * @brief Applies the update of one state-action pair to its active tiles.
+     *
+     * @param offsets Active tile of each tiling
+     * @param action Action value
+     * @param target Target value
+     * @param weight Factor of the step
+     * @return Unscaled value error
+     */
+    double update_tiles(const Eigen::Index* offsets, int action, double target,
+        double weight = 1.0);
+
+    /**
+     * @brief Prefetches the active tiles of one state into the cache.
+     *
+     * @param offsets Active tile of each tiling
+     */
+    void prefetch_tiles(const Eigen::Index* offsets) const;
+
+  protected:
+    double predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        int action) override;
+
+    Eigen::VectorXd predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state,
+        const Eigen::Ref<const Eigen::VectorXi>& actions) override;
+
+    void predict_all_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        Eigen::Ref<Eigen::VectorXd> values_out) override;
+
+    int greedy_action_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state) override;
+
+    double update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target) override;
+
+    double weighted_update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target,
+        double weight) override;
+
+    void predict_batch_implementation(
+        const Eigen::Ref<const Eigen::MatrixXd>& states,
+        const Eigen::Ref<const Eigen::VectorXi>& actions,
+        Eigen::Ref<Eigen::VectorXd> values_out) override;
+
+    void update_batch_implementation(
+        const Eigen::Ref<const Eigen::MatrixXd>& states,
+        const Eigen::Ref<const Eigen::VectorXi>& actions,
+        const Eigen::Ref<const Eigen::VectorXd>& targets,
+        Eigen::Ref<Eigen::VectorXd> errors_out) override;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,176 @@
+#include "src/approximator/tile_index_kernel.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TILE_INDEX_KERNEL_X86
+#endif
+
+namespace {
+// Widest vector in tilings (AVX-512 holds 16 floats)
+const int VECTOR_WIDTH = 16;
+
+#ifdef TILE_INDEX_KERNEL_X86
+__attribute__((target("avx2")))
+void mixed_radix_avx2(const float* state, int tilings, int lanes, int axis_slots,
+        const int32_t* dimension, const float* min_value, const float* scale,
+        const float* last_cell, const int32_t* segments, int32_t* indices_out) {
+    const __m256 zero = _mm256_setzero_ps();
+    for (int t = 0; t < tilings; t += 8) {
+        __m256i index = _mm256_setzero_si256();
+        for (int j = 0; j < axis_slots; j++) {
+            const int k = j * lanes + t;
+            __m256i dims = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(dimension + k));
+            __m256 x = _mm256_i32gather_ps(state, dims, 4);
+            __m256 position = _mm256_mul_ps(
+                _mm256_sub_ps(x, _mm256_loadu_ps(min_value + k)),
+                _mm256_loadu_ps(scale + k));
+            position = _mm256_min_ps(_mm256_max_ps(position, zero),
+                _mm256_loadu_ps(last_cell + k));
+            __m256i cell = _mm256_cvttps_epi32(position);
+            __m256i radix = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(segments + k));
+            index = _mm256_add_epi32(_mm256_mullo_epi32(index, radix), cell);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(indices_out + t), index);
+    }
+}
+
+// GCC warns about the intentionally undefined pass-through operand of the
+// unmasked AVX-512 intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+void mixed_radix_avx512(const float* state, int tilings, int lanes, int axis_slots,
+        const int32_t* dimension, const float* min_value, const float* scale,
+        const float* last_cell, const int32_t* segments, int32_t* indices_out) {
+    const __m512 zero = _mm512_setzero_ps();
+    for (int t = 0; t < tilings; t += 16) {
+        __m512i index = _mm512_setzero_si512();
+        for (int j = 0; j < axis_slots; j++) {
+            const int k = j * lanes + t;
+            __m512i dims = _mm512_loadu_si512(dimension + k);
+            __m512 x = _mm512_i32gather_ps(dims, state, 4);
+            __m512 position = _mm512_mul_ps(
+                _mm512_sub_ps(x, _mm512_loadu_ps(min_value + k)),
+                _mm512_loadu_ps(scale + k));
+            position = _mm512_min_ps(_mm512_max_ps(position, zero),
+                _mm512_loadu_ps(last_cell + k));
+            __m512i cell = _mm512_cvttps_epi32(position);
+            __m512i radix = _mm512_loadu_si512(segments + k);
+            index = _mm512_add_epi32(_mm512_mullo_epi32(index, radix), cell);
+        }
+        _mm512_storeu_si512(indices_out + t, index);
+    }
+}
+#pragma GCC diagnostic pop
+#endif
+}
+
+TileIndexKernel::TileIndexKernel()
+    : tilings(0), lanes(0), axis_slots(0), dimensions(0), actions(0),
+      selected(InstructionSet::SCALAR) {}
+
+TileIndexKernel::TileIndexKernel(
+        const std::vector<TileAxis>& axes,
+        const std::vector<int>& tiling_axes,
+        const std::vector<Eigen::Index>& tiling_offset,
+        int actions)
+    : tilings(tiling_offset.size()), axis_slots(0), dimensions(0),
+      actions(actions), selected(InstructionSet::SCALAR), offset(tiling_offset) {
+    if (tilings > MAX_TILINGS)
+        throw std::invalid_argument("Number of tilings is out of range.");
+    lanes = (tilings + VECTOR_WIDTH - 1) / VECTOR_WIDTH * VECTOR_WIDTH;
+    for (int t = 0; t < tilings; t++) {
+        axis_slots = std::max(axis_slots, tiling_axes[t+1] - tiling_axes[t]);
+    }
+
+    // Unused slots have one segment and a zero cell
+    const int size = axis_slots * lanes;
+    dimension.assign(size, 0);
+    min_value.assign(size, 0.0f);
+    scale.assign(size, 0.0f);
+    last_cell.assign(size, 0.0f);
+    segments.assign(size, 1);
+
+    // SIMD lanes use 32 bit indices and exact float segment bounds
+    bool vector_safe = true;
+    for (int t = 0; t < tilings; t++) {
+        Eigen::Index tiles = 1;
+        for (int a = tiling_axes[t]; a < tiling_axes[t+1]; a++) {
+            const TileAxis& axis = axes[a];
+            if (axis.dimension < 0 || axis.dimension >= MAX_DIMENSIONS)
+                throw std::invalid_argument("State dimension is out of range.");
+            const int k = (a - tiling_axes[t]) * lanes + t;
+            dimension[k] = axis.dimension;
+            min_value[k] = axis.min_value;
+            scale[k] = axis.scale;
+            last_cell[k] = float(axis.segments - 1);
+            segments[k] = axis.segments;
+            dimensions = std::max(dimensions, axis.dimension + 1);
+            tiles *= axis.segments;
+            vector_safe &= axis.segments < (1 << 24);
+        }
+        vector_safe &= tiles <= std::numeric_limits<int32_t>::max();
+    }
+
+#ifdef TILE_INDEX_KERNEL_X86
+    __builtin_cpu_init();
+    // A single AVX2 vector is cheaper for few tilings
+    if (vector_safe && tilings > 8 && __builtin_cpu_supports("avx512f")) {
+        selected = InstructionSet::AVX512;
+    } else if (vector_safe && __builtin_cpu_supports("avx2")) {
+        selected = InstructionSet::AVX2;
+    }
+#endif
+}
+
+void TileIndexKernel::compute_scalar(
+        const float* state, Eigen::Index* offsets_out) const {
+    for (int t = 0; t < tilings; t++) {
+        Eigen::Index index = 0;
+        for (int j = 0; j < axis_slots; j++) {
+            const int k = j * lanes + t;
+            float position = (state[dimension[k]] - min_value[k]) * scale[k];
+            position = std::min(std::max(position, 0.0f), last_cell[k]);
+            Eigen::Index cell = std::min<Eigen::Index>(
+                Eigen::Index(position), segments[k] - 1);
+            index = index * segments[k] + cell;
+        }
+        offsets_out[t] = offset[t] + index * actions;
+    }
+}
+
+void TileIndexKernel::compute(const double* states, Eigen::Index stride,
+        int count, Eigen::Index* offsets_out) const {
+    float state[MAX_DIMENSIONS];
+    alignas(64) int32_t indices[MAX_TILINGS + VECTOR_WIDTH];
+    for (int i = 0; i < count; i++) {
+        const double* source = states + i * stride;
+        for (int d = 0; d < dimensions; d++) state[d] = float(source[d]);
+        Eigen::Index* offsets = offsets_out + Eigen::Index(i) * tilings;
+
+        switch (selected) {
+#ifdef TILE_INDEX_KERNEL_X86
+            case InstructionSet::AVX512:
+                mixed_radix_avx512(state, tilings, lanes, axis_slots, dimension.data(),
+                    min_value.data(), scale.data(), last_cell.data(),
+                    segments.data(), indices);
+                break;
+            case InstructionSet::AVX2:
+                mixed_radix_avx2(state, tilings, lanes, axis_slots, dimension.data(),
+                    min_value.data(), scale.data(), last_cell.data(),
+                    segments.data(), indices);
+                break;
+#endif
+            default:
+                compute_scalar(state, offsets);
+                continue;
+        }
+        for (int t = 0; t < tilings; t++) {
+            offsets[t] = offset[t] + Eigen::Index(indices[t]) * actions;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef __TILE_INDEX_KERNEL_H_
+#define __TILE_INDEX_KERNEL_H_
+
+#include "Eigen/Dense"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Discretization of one state dimension within one tiling.
+ */
+struct TileAxis {
+    int dimension;   //<! State dimension
+    float min_value; //<! Lower bound of the tiling in this dimension
+    float scale;     //<! Inverse size of a segment
+    int segments;    //<! Number of segments
+};
+
+/**
+ * @brief Computes the active tile of every tiling for a batch of states. The
+ *        tilings are processed in SIMD lanes (AVX2 or AVX-512, selected at
+ *        runtime) with a scalar fallback. Tilings with 2^31 or more tiles
+ *        or 2^24 or more segments per axis always use the scalar 64 bit path.
+ */
+class TileIndexKernel {
+  public:
+    static constexpr int MAX_DIMENSIONS = 64; //<! Upper bound for the state size
+    static constexpr int MAX_TILINGS = 64;    //<! Upper bound for the number of tilings
+
+    /**
+     * @brief Instruction sets the kernel can use
+     */
+    enum class InstructionSet {
+        SCALAR, //<! Portable C++
+        AVX2,   //<! 8 tilings per instruction
+        AVX512  //<! 16 tilings per instruction
+    };
+
+    /**
+     * @brief Construct an empty kernel
+     *
+     */
+    TileIndexKernel();
+
+    /**
+     * @brief Construct a new tile index kernel
+     *
+     * @param axes Axes of all tilings, stored tiling after tiling
+     * @param tiling_axes First axis of each tiling (plus end marker)
+     * @param tiling_offset Start of each tiling in the weight table
+     * @param actions Number of values per tile
+     */
+    TileIndexKernel(
+        const std::vector<TileAxis>& axes,
+        const std::vector<int>& tiling_axes,
+        const std::vector<Eigen::Index>& tiling_offset,
+        int actions);
+
+    /**
+     * @brief Computes the index of the active tile's first action in every
+     *        tiling for a batch of states.
+     *
+     * @param states First state, consecutive states follow at a fixed stride
+     * @param stride Distance between consecutive states
+     * @param count Number of states
+     * @param offsets_out Output of count x tilings indices, state after state
+     */
+    void compute(const double* states, Eigen::Index stride, int count,
+        Eigen::Index* offsets_out) const;
+
+    /**
+     * @brief Get the instruction set used by compute
+     *
+     * @return InstructionSet
+     */
+    InstructionSet instruction_set() const { return selected; }
+
+  private:
+    int tilings;    //<! Number of tilings
+    int lanes;      //<! Number of tilings rounded up to a multiple of the widest vector
+    int axis_slots; //<! Largest number of axes of a tiling
+    int dimensions; //<! Number of state dimensions read
+    int actions;    //<! Number of values per tile
+    InstructionSet selected; //<! Instruction set used by compute
+    // Axis parameters as [axis slot][tiling], unused entries leave the index unchanged
+    std::vector<int32_t> dimension;   //<! State dimension
+    std::vector<float> min_value;     //<! Lower bound of the tiling
+    std::vector<float> scale;         //<! Inverse size of a segment
+    std::vector<float> last_cell;     //<! Largest segment index
+    std::vector<int32_t> segments;    //<! Number of segments
+    std::vector<Eigen::Index> offset; //<! Start of each tiling in the weight table
+
+    /**
+     * @brief Portable 64 bit implementation for one state
+     *
+     * @param state State vector converted to float
+     * @param offsets_out Output of one index per tiling
+     */
+    void compute_scalar(const float* state, Eigen::Index* offsets_out) const;
+};
+
+#endif
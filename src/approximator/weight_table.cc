@@ -0,0 +1,307 @@
+#include "src/approximator/weight_table.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <omp.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+// Number of weights converted per stream operation
+const std::size_t CHUNK_SIZE = 1 << 16;
+
+float* allocate(std::size_t size) {
+    if (size == 0) return nullptr;
+    // std::aligned_alloc requires a multiple of the alignment
+    std::size_t bytes = size * sizeof(float);
+    bytes = (bytes + WeightTable::ALIGNMENT - 1)
+        / WeightTable::ALIGNMENT * WeightTable::ALIGNMENT;
+    void* memory = std::aligned_alloc(WeightTable::ALIGNMENT, bytes);
+    if (!memory) throw std::bad_alloc();
+    return static_cast<float*>(memory);
+}
+
+// Memory policies of the mbind system call (see numaif.h)
+const int MPOL_BIND_POLICY = 2;
+const int MPOL_INTERLEAVE_POLICY = 3;
+const std::size_t HUGE_PAGE_SIZE = 2 << 20;
+
+std::size_t mapping_size(std::size_t size) {
+    std::size_t bytes = size * sizeof(float);
+    return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+// Anonymous mapping on huge pages, placed according to the NUMA policy.
+// The policy is best effort, kernels without NUMA support ignore it.
+float* allocate_placed(std::size_t size, MemoryPlacement placement, int node) {
+    std::size_t bytes = mapping_size(size);
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) throw std::bad_alloc();
+    madvise(memory, bytes, MADV_HUGEPAGE);
+
+    if (placement != MemoryPlacement::FIRST_TOUCH) {
+        const int nodes = WeightTable::numa_nodes();
+        unsigned long mask = 0;
+        if (placement == MemoryPlacement::INTERLEAVE) {
+            for (int n = 0; n < nodes && n < 64; n++) mask |= 1UL << n;
+        } else {
+            mask = 1UL << (node % 64);
+        }
+        syscall(SYS_mbind, memory, bytes,
+            placement == MemoryPlacement::INTERLEAVE ?
+                MPOL_INTERLEAVE_POLICY : MPOL_BIND_POLICY,
+            &mask, 64, 0);
+    }
+    return static_cast<float*>(memory);
+}
+
+// Copies in parallel, so first-touch placement follows the worker threads
+void parallel_copy(float* target, const float* source, std::size_t size) {
+    #pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < size; i++) target[i] = source[i];
+}
+}
+
+int WeightTable::numa_nodes() {
+    // Format is a list of ranges, e.g. "0-1"
+    std::ifstream online("/sys/devices/system/node/online");
+    int first = 0, last = 0;
+    char separator = 0;
+    if (!(online >> first)) return 1;
+    if (online >> separator >> last && separator == '-') return last + 1;
+    return first + 1;
+}
+
+int WeightTable::local_node() const {
+    thread_local int node = -1;
+    if (node < 0) {
+        unsigned int cpu = 0, cpu_node = 0;
+        node = syscall(SYS_getcpu, &cpu, &cpu_node, nullptr) == 0 ? cpu_node : 0;
+    }
+    return node < int(replicas.size()) ? node : 0;
+}
+
+WeightTable::WeightTable()
+    : buffer(nullptr), length(0), storage(Storage::HEAP), restored(false) {}
+
+WeightTable::WeightTable(std::size_t size)
+    : buffer(allocate(size)), length(size), storage(Storage::HEAP),
+      restored(false) {}
+
+WeightTable::WeightTable(std::size_t size, const std::string& filename,
+        const std::string& layout)
+    : buffer(nullptr), length(size), storage(Storage::FILE), restored(false) {
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open weight file " + filename
+            + ": " + std::strerror(errno));
+
+    // Existing weights are only reused with the layout they were learned in
+    const off_t bytes = off_t(size * sizeof(float));
+    const std::string layout_file = filename + ".layout";
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        std::ifstream infile(layout_file, std::ios_base::binary);
+        std::string stored((std::istreambuf_iterator<char>(infile)),
+            std::istreambuf_iterator<char>());
+        if (info.st_size != bytes || stored != layout) {
+            close(fd);
+            throw std::runtime_error("Weight file " + filename
+                + " has a different layout, remove it to start over");
+        }
+        restored = true;
+    } else {
+        // The file is zero until the approximator initializes it
+        std::ofstream outfile(layout_file, std::ios_base::binary | std::ios_base::trunc);
+        outfile.write(layout.data(), static_cast<std::streamsize>(layout.size()));
+        if (!outfile || ftruncate(fd, bytes) != 0) {
+            close(fd);
+            throw std::runtime_error("Cannot create weight file " + filename
+                + ": " + std::strerror(errno));
+        }
+    }
+
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+        MAP_SHARED, fd, 0);
+    // The mapping keeps the file alive
+    close(fd);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Cannot map weight file " + filename
+            + ": " + std::strerror(errno));
+    buffer = static_cast<float*>(memory);
+}
+
+WeightTable::WeightTable(const std::string& filename, std::size_t offset,
+        std::size_t size)
+    : buffer(nullptr), length(size), storage(Storage::SNAPSHOT), restored(true) {
+    if (size == 0) return;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open weight file " + filename
+            + ": " + std::strerror(errno));
+    void* memory = mmap(nullptr, size * sizeof(float), PROT_READ | PROT_WRITE,
+        MAP_PRIVATE, fd, off_t(offset));
+    close(fd);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Cannot map weight file " + filename
+            + ": " + std::strerror(errno));
+    buffer = static_cast<float*>(memory);
+}
+
+WeightTable::WeightTable(const WeightTable& other)
+    : buffer(allocate(other.length)), length(other.length),
+      storage(Storage::HEAP), restored(false) {
+    if (length) std::memcpy(buffer, other.buffer, length * sizeof(float));
+}
+
+WeightTable::WeightTable(WeightTable&& other) noexcept
+    : buffer(other.buffer), length(other.length),
+      storage(other.storage), restored(other.restored),
+      replicas(std::move(other.replicas)), changed(std::move(other.changed)),
+      trackers(other.trackers) {
+    other.buffer = nullptr;
+    other.length = 0;
+    other.storage = Storage::HEAP;
+    other.replicas.clear();
+    other.trackers = 0;
+}
+
+WeightTable& WeightTable::operator=(WeightTable other) {
+    std::swap(buffer, other.buffer);
+    std::swap(length, other.length);
+    std::swap(storage, other.storage);
+    std::swap(restored, other.restored);
+    std::swap(replicas, other.replicas);
+    // Tracking stays with this table, all weights are new
+    if (changed) {
+        changed.reset(new uint8_t[blocks()]);
+        mark_all_changed();
+    }
+    return *this;
+}
+
+WeightTable::~WeightTable() {
+    release();
+}
+
+void WeightTable::release() {
+    for (float* replica : replicas) munmap(replica, mapping_size(length));
+    replicas.clear();
+    if (storage == Storage::FILE || storage == Storage::SNAPSHOT) {
+        if (buffer) munmap(buffer, length * sizeof(float));
+    } else if (storage == Storage::ANONYMOUS) {
+        munmap(buffer, mapping_size(length));
+    } else {
+        std::free(buffer);
+    }
+    buffer = nullptr;
+}
+
+void WeightTable::sync() {
+    if (storage == Storage::FILE) msync(buffer, length * sizeof(float), MS_SYNC);
+}
+
+void WeightTable::place(MemoryPlacement placement, int node) {
+    if (storage == Storage::FILE || length == 0) return;
+    float* placed = allocate_placed(length, placement, node);
+    parallel_copy(placed, buffer, length);
+    bool had_replicas = !replicas.empty();
+    release();
+    buffer = placed;
+    storage = Storage::ANONYMOUS;
+    if (had_replicas) replicate(true);
+}
+
+void WeightTable::replicate(bool enable) {
+    for (float* replica : replicas) munmap(replica, mapping_size(length));
+    replicas.clear();
+    if (!enable || length == 0) return;
+    for (int node = 0; node < numa_nodes(); node++) {
+        replicas.push_back(allocate_placed(length, MemoryPlacement::BIND, node));
+    }
+    sync_replicas();
+}
+
+void WeightTable::sync_replicas() {
+    for (float* replica : replicas) parallel_copy(replica, buffer, length);
+}
+
+int WeightTable::add_tracker() {
+    int tracker = 0;
+    while (tracker < 8 && (trackers & (1u << tracker))) tracker++;
+    if (tracker == 8) throw std::length_error("Too many change trackers.");
+    const uint8_t bit = uint8_t(1u << tracker);
+    if (!changed) changed.reset(new uint8_t[blocks()]());
+    // Marks of a former tracker with the same bit are stale
+    for (std::size_t block = 0; block < blocks(); block++) changed[block] &= uint8_t(~bit);
+    trackers |= bit;
+    return tracker;
+}
+
+void WeightTable::remove_tracker(int tracker) {
+    trackers &= uint8_t(~(1u << tracker));
+    if (!trackers) changed.reset();
+}
+
+void WeightTable::mark_all_changed() {
+    if (changed) std::fill(changed.get(), changed.get() + blocks(), trackers);
+}
+
+std::vector<std::size_t> WeightTable::take_changed_blocks(int tracker) {
+    std::vector<std::size_t> result;
+    if (!changed) return result;
+    const uint8_t bit = uint8_t(1u << tracker);
+    for (std::size_t block = 0; block < blocks(); block++) {
+        // Only blocks marked for this tracker are written
+        if ((__atomic_load_n(&changed[block], __ATOMIC_RELAXED) & bit)
+            && (__atomic_fetch_and(&changed[block], uint8_t(~bit), __ATOMIC_RELAXED) & bit))
+            result.push_back(block);
+    }
+    return result;
+}
+
+void WeightTable::write_action_major(std::ostream& stream,
+        std::size_t begin, std::size_t states, int actions) const {
+    std::vector<float> chunk(std::min(states, CHUNK_SIZE));
+    for (int action = 0; action < actions; action++) {
+        for (std::size_t first = 0; first < states; first += chunk.size()) {
+            std::size_t count = std::min(chunk.size(), states - first);
+            const float* source = buffer + begin + first * actions + action;
+            for (std::size_t i = 0; i < count; i++) {
+                chunk[i] = source[i * actions];
+            }
+            stream.write(reinterpret_cast<const char*>(chunk.data()),
+                static_cast<int64_t>(count * sizeof(float)));
+        }
+    }
+}
+
+void WeightTable::read_action_major(std::istream& stream,
+        std::size_t begin, std::size_t states, int actions) {
+    std::vector<float> chunk(std::min(states, CHUNK_SIZE));
+    for (int action = 0; action < actions; action++) {
+        for (std::size_t first = 0; first < states; first += chunk.size()) {
+            std::size_t count = std::min(chunk.size(), states - first);
+            stream.read(reinterpret_cast<char*>(chunk.data()),
+                static_cast<int64_t>(count * sizeof(float)));
+            // Keep the old values where the stream ran short
+            count = std::min<std::size_t>(count, stream.gcount() / sizeof(float));
+            float* target = buffer + begin + first * actions + action;
+            for (std::size_t i = 0; i < count; i++) {
+                target[i * actions] = chunk[i];
+            }
+        }
+    }
+    mark_all_changed();
+}
@@ -0,0 +1,298 @@
+#ifndef __WEIGHT_TABLE_H_
+#define __WEIGHT_TABLE_H_
+
+#include "Eigen/Dense"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Placement of the weights on the NUMA nodes of the machine.
+ */
+enum class MemoryPlacement {
+    FIRST_TOUCH, //<! Pages are placed on the node of the first accessing thread
+    INTERLEAVE,  //<! Pages are distributed round-robin over all nodes
+    BIND         //<! All pages are placed on one node
+};
+
+/**
+ * @brief Contiguous, cache-line aligned storage for approximator weights.
+ *        The weights either live on the heap, in anonymous memory placed on
+ *        NUMA nodes (optionally replicated per node), in a memory-mapped file
+ *        or in a private mapping of a checkpoint.
+ */
+class WeightTable {
+  public:
+    static constexpr std::size_t ALIGNMENT = 64;    //<! Alignment of the buffer in bytes
+    static constexpr std::size_t BLOCK_SIZE = 1024; //<! Weights per block of change tracking (4 KiB)
+
+    /**
+     * @brief Construct an empty weight table
+     *
+     */
+    WeightTable();
+
+    /**
+     * @brief Construct a new weight table (values are uninitialized)
+     *
+     * @param size Number of weights
+     */
+    explicit WeightTable(std::size_t size);
+
+    /**
+     * @brief Construct a new weight table backed by a memory-mapped file. The
+     *        OS pages the weights, so the table may be larger than RAM, and
+     *        the values survive restarts. The sidecar file filename.layout
+     *        stores the layout of the weights. An existing file is only
+     *        reused with the same layout, otherwise a runtime_error is thrown.
+     *        New files are zero.
+     *
+     * @param size Number of weights
+     * @param filename File to map, created if it does not exist or is empty
+     * @param layout Description of the approximator, e.g. Checkpoint::describe
+     */
+    WeightTable(std::size_t size, const std::string& filename, const std::string& layout);
+
+    /**
+     * @brief Construct a new weight table which maps weights stored in an
+     *        existing file privately (copy-on-write). Pages are shared with
+     *        the page cache until they are written, changes never reach the
+     *        file.
+     *
+     * @param filename File to map
+     * @param offset Byte offset of the first weight, a multiple of the page size
+     * @param size Number of weights
+     */
+    WeightTable(const std::string& filename, std::size_t offset, std::size_t size);
+
+    /**
+     * @brief Copies the weights, the copy always lives on the heap
+     *
+     * @param other Table to copy
+     */
+    WeightTable(const WeightTable& other);
+
+    WeightTable(WeightTable&& other) noexcept;
+
+    WeightTable& operator=(WeightTable other);
+
+    ~WeightTable();
+
+    /**
+     * @brief Check whether the weights are stored in a mapped file
+     *
+     * @return bool
+     */
+    bool isMapped() const { return storage == Storage::FILE; }
+
+    /**
+     * @brief Check whether the weights were restored from an existing file
+     *
+     * @return bool
+     */
+    bool isRestored() const { return restored; }
+
+    /**
+     * @brief Writes modified pages of a mapped table back to its file
+     *
+     */
+    void sync();
+
+    /**
+     * @brief Moves the weights to memory with the given NUMA placement,
+     *        backed by 2 MB huge pages where available. File-mapped tables
+     *        stay where they are.
+     *
+     * @param placement Placement policy
+     * @param node NUMA node for BIND
+     */
+    void place(MemoryPlacement placement, int node = 0);
+
+    /**
+     * @brief Keeps one read-only replica of the weights on every NUMA node.
+     *        Reads through local_data() use the replica of the calling
+     *        thread's node, writes go to data() and reach the replicas with
+     *        sync_replicas(). Between syncs the replicas lag behind the
+     *        writes. Threads have to be pinned (OMP_PROC_BIND), the node of
+     *        a thread is looked up once.
+     *
+     * @param enable Create (true) or remove (false) the replicas
+     */
+    void replicate(bool enable);
+
+    /**
+     * @brief Check whether read-only replicas of the weights exist
+     *
+     * @return bool
+     */
+    bool isReplicated() const { return !replicas.empty(); }
+
+    /**
+     * @brief Copies the weights into all replicas, all threads copy a part.
+     *        Must be called outside of parallel regions while no thread
+     *        writes the weights.
+     *
+     */
+    void sync_replicas();
+
+    /**
+     * @brief Starts recording which blocks of BLOCK_SIZE weights change for
+     *        a new consumer, e.g. a checkpoint. Every consumer has its own
+     *        bit in the mark of a block and takes its changes independently.
+     *        Writers have to report their changes with mark_changed.
+     *        Assigning new weights to a tracked table marks all blocks.
+     *
+     * @return Tracker of the consumer, no block is marked for it yet
+     */
+    int add_tracker();
+
+    /**
+     * @brief Stops recording changes for a consumer
+     *
+     * @param tracker Tracker returned by add_tracker
+     */
+    void remove_tracker(int tracker);
+
+    /**
+     * @brief Check whether any consumer records changes
+     *
+     * @return bool
+     */
+    bool isTracked() const { return trackers != 0; }
+
+    /**
+     * @brief Marks the block of a weight as changed for all trackers. The
+     *        mark is only written if it is not complete yet, so writers of a
+     *        marked block share its cache line instead of invalidating it.
+     *
+     * @param weight Changed weight
+     */
+    void mark_changed(const float* weight) {
+        if (changed) {
+            std::size_t block = std::size_t(weight - buffer) / BLOCK_SIZE;
+            if (__atomic_load_n(&changed[block], __ATOMIC_RELAXED) != trackers)
+                __atomic_store_n(&changed[block], trackers, __ATOMIC_RELAXED);
+        }
+    }
+
+    /**
+     * @brief Marks all blocks as changed, e.g. after loading new weights
+     *
+     */
+    void mark_all_changed();
+
+    /**
+     * @brief Get the blocks changed since the last call for a tracker and
+     *        reset their marks of this tracker
+     *
+     * @param tracker Tracker returned by add_tracker
+     * @return Indices of the changed blocks in ascending order
+     */
+    std::vector<std::size_t> take_changed_blocks(int tracker);
+
+    /**
+     * @brief Get the number of blocks of change tracking
+     *
+     * @return std::size_t
+     */
+    std::size_t blocks() const { return (length + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+
+    /**
+     * @brief Get the number of NUMA nodes of the machine
+     *
+     * @return int
+     */
+    static int numa_nodes();
+
+    /**
+     * @brief Weights to read from, the replica of the calling thread's NUMA
+     *        node if replicas exist.
+     *
+     * @return const float*
+     */
+    const float* local_data() const {
+        return replicas.empty() ? buffer : replicas[local_node()];
+    }
+
+    float* data() { return buffer; }
+
+    const float* data() const { return buffer; }
+
+    std::size_t size() const { return length; }
+
+    float& operator[](std::size_t index) { return buffer[index]; }
+
+    float operator[](std::size_t index) const { return buffer[index]; }
+
+    /**
+     * @brief Access the weights as an Eigen vector
+     *
+     * @return Eigen::Map<Eigen::VectorXf>
+     */
+    Eigen::Map<Eigen::VectorXf> vector() {
+        return Eigen::Map<Eigen::VectorXf>(buffer, length);
+    }
+
+    /**
+     * @brief Writes a block stored action-minor ([state][action]) in the
+     *        action-major ([action][state]) file layout.
+     *
+     * @param stream Output stream
+     * @param begin Index of the first weight of the block
+     * @param states Number of states in the block
+     * @param actions Number of actions per state
+     */
+    void write_action_major(std::ostream& stream,
+        std::size_t begin, std::size_t states, int actions) const;
+
+    /**
+     * @brief Reads a block in action-major file layout into the action-minor
+     *        layout used in memory.
+     *
+     * @param stream Input stream
+     * @param begin Index of the first weight of the block
+     * @param states Number of states in the block
+     * @param actions Number of actions per state
+     */
+    void read_action_major(std::istream& stream,
+        std::size_t begin, std::size_t states, int actions);
+
+  private:
+    /**
+     * @brief Origin of the buffer memory
+     */
+    enum class Storage {
+        HEAP,      //<! Aligned heap allocation
+        ANONYMOUS, //<! Anonymous mapping with NUMA policy
+        FILE,      //<! Shared file mapping
+        SNAPSHOT   //<! Private (copy-on-write) file mapping
+    };
+
+    float* buffer;                //<! Aligned weight storage
+    std::size_t length;           //<! Number of weights
+    Storage storage;              //<! Origin of the buffer
+    bool restored;                //<! Mapped file already contained the weights
+    std::vector<float*> replicas; //<! Read-only copy per NUMA node
+    std::unique_ptr<uint8_t[]> changed; //<! Change marks per block (one bit per tracker) while tracking
+    uint8_t trackers = 0;         //<! Bits of the active trackers
+
+    /**
+     * @brief Get the NUMA node of the calling thread (cached per thread,
+     *        so the thread must not migrate to another node)
+     *
+     * @return int
+     */
+    int local_node() const;
+
+    /**
+     * @brief Releases buffer and replicas
+     *
+     */
+    void release();
+};
+
+#endif
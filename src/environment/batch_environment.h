@@ -0,0 +1,62 @@
+#ifndef __BATCH_ENVIRONMENT_H_
+#define __BATCH_ENVIRONMENT_H_
+
+#include "Eigen/Dense"
+
+/**
+ * @brief Base class for environments which simulate a batch of independent
+ *        instances in lockstep. Observations have one column per instance,
+ *        the layout of the batched approximator calls. Instances which reach
+ *        a final state are reset within the same step.
+ *
+ */
+class BatchEnvironment {
+  public:
+    BatchEnvironment() {}
+
+    virtual ~BatchEnvironment() {}
+
+    /**
+     * @brief Get the Number Of possible discrete Actions
+     *
+     * @return int
+     */
+    virtual int getNumberOfActions() = 0;
+
+    /**
+     * @brief Get the number of state-space dimensions
+     *
+     * @return int
+     */
+    virtual int getStateDim() = 0;
+
+    /**
+     * @brief Get the number of instances
+     *
+     * @return int
+     */
+    virtual int getBatchSize() = 0;
+
+    /**
+     * @brief Perform one step in every instance. Instances which reach a
+     *        final state are reset, their observation is the first state of
+     *        the next episode.
+     *
+     * @param actions Action to take in each instance
+     * @param observations Output of the new observations, one column per instance
+     * @param done Output of 1 for instances which reached a final state, 0 otherwise
+     */
+    virtual void step(
+        const Eigen::Ref<const Eigen::VectorXi>& actions,
+        Eigen::Ref<Eigen::MatrixXd> observations,
+        Eigen::Ref<Eigen::VectorXi> done) = 0;
+
+    /**
+     * @brief Resets all instances
+     *
+     * @param observations Output of the new observations, one column per instance
+     */
+    virtual void reset(Eigen::Ref<Eigen::MatrixXd> observations) = 0;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "src/environment/batch_flappy_simulator.h"
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+typedef FlappySimulator F;
+
+const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+// Next number of a SplitMix64 stream, the 64-bit multiplies only
+// vectorize with AVX-512DQ (vpmullq)
+inline uint64_t next_random(uint64_t& position) {
+    uint64_t z = (position += GOLDEN_GAMMA);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Uniform value in [0, 1) from the upper 53 bits
+inline double to_unit(uint64_t bits) {
+    return double(bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Vertical middle of a new pipe opening
+inline double pipe_opening_y(double unit) {
+    return unit * (F::screen_height - F::pipe_opening * 1.5) + F::pipe_opening * 0.75;
+}
+
+// Value limited to [low, high], by value so the compiler can vectorize it
+inline double clamp(double value, double low, double high) {
+    value = value < low ? low : value;
+    return value > high ? high : value;
+}
+
+// Circle (the bird) overlaps the rectangle, without branches
+inline bool overlaps(double y, double x1, double y1, double x2, double y2) {
+    double dx = clamp(F::flappy_x, x1, x2) - F::flappy_x;
+    double dy = clamp(y, y1, y2) - y;
+    return dx * dx + dy * dy <= F::flappy_radius * F::flappy_radius;
+}
+
+// Bird hits the lower or the upper part of a pipe
+inline bool hits_pipe(double y, double pipe_x, double pipe_y) {
+    double pipe_left = pipe_x - F::pipe_width;
+    double pipe_lower_top = pipe_y + F::pipe_opening / 2.0;
+    double pipe_upper_bottom = pipe_lower_top - F::pipe_opening;
+    return overlaps(y, pipe_left, pipe_lower_top, pipe_x, F::screen_height)
+        | overlaps(y, pipe_left, 0.0, pipe_x, pipe_upper_bottom);
+}
+}
+
+BatchFlappySimulator::BatchFlappySimulator(int batch_size, uint64_t seed)
+    : batch_size(batch_size),
+      pipe_1_x(batch_size), pipe_1_y(batch_size), pipe_2_y(batch_size),
+      flappy_y(batch_size), flappy_v(batch_size), random(batch_size) {
+    if (batch_size <= 0)
+        throw std::invalid_argument("Batch size must be positive.");
+    if (seed == 0) {
+        seed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    }
+    // Streams start at scattered positions of the sequence
+    for (int i=0; i < batch_size; i++) {
+        uint64_t position = seed + uint64_t(i) * GOLDEN_GAMMA;
+        random[i] = next_random(position);
+    }
+}
+
+Eigen::MatrixXd BatchFlappySimulator::getStates() const {
+    Eigen::MatrixXd states(F::SIZE_OF_STATESPACE, batch_size);
+    observe(states);
+    return states;
+}
+
+void BatchFlappySimulator::observe(Eigen::Ref<Eigen::MatrixXd> observations) const {
+    for (int i=0; i < batch_size; i++) {
+        observations(F::PIPE_1_X, i) = pipe_1_x[i];
+        observations(F::PIPE_1_Y, i) = pipe_1_y[i];
+        observations(F::PIPE_2_Y, i) = pipe_2_y[i];
+        observations(F::FLAPPY_Y, i) = flappy_y[i];
+        observations(F::FLAPPY_V, i) = flappy_v[i];
+    }
+}
+
+void BatchFlappySimulator::reset(Eigen::Ref<Eigen::MatrixXd> observations) {
+    if (observations.rows() != F::SIZE_OF_STATESPACE || observations.cols() != batch_size)
+        throw std::invalid_argument("Observation matrix has wrong size.");
+    for (int i=0; i < batch_size; i++) {
+        uint64_t first = next_random(random[i]);
+        uint64_t second = next_random(random[i]);
+        pipe_1_x[i] = F::flappy_x - F::flappy_radius + double(first & 1) * F::pipe_distance;
+        pipe_1_y[i] = pipe_opening_y(to_unit(first));
+        pipe_2_y[i] = pipe_opening_y(to_unit(second));
+        flappy_y[i] = F::screen_height / 2.0;
+        flappy_v[i] = 0.0;
+    }
+    observe(observations);
+}
+
+void BatchFlappySimulator::step(
+        const Eigen::Ref<const Eigen::VectorXi>& actions,
+        Eigen::Ref<Eigen::MatrixXd> observations,
+        Eigen::Ref<Eigen::VectorXi> done) {
+    if (actions.size() != batch_size || done.size() != batch_size)
+        throw std::invalid_argument("Action vector has wrong size.");
+    if (observations.rows() != F::SIZE_OF_STATESPACE || observations.cols() != batch_size)
+        throw std::invalid_argument("Observation matrix has wrong size.");
+
+    const int* action = actions.data();
+    int* done_out = done.data();
+    double* p1x = pipe_1_x.data();
+    double* p1y = pipe_1_y.data();
+    double* p2y = pipe_2_y.data();
+    double* fy = flappy_y.data();
+    double* fv = flappy_v.data();
+    uint64_t* position = random.data();
+
+    // Same physics as FlappySimulator::step, selects instead of branches
+    #pragma omp simd
+    for (int i=0; i < batch_size; i++) {
+        double acceleration = F::gravity - double(action[i]) * F::flappy_accel;
+        double v = clamp(fv[i] + acceleration * F::dt, -F::flappy_vmax, F::flappy_vmax);
+        double y = fy[i] + fv[i] * F::dt + 0.5 * acceleration * F::dt * F::dt;
+
+        // Random numbers for new pipes, also used by a reset
+        uint64_t first = next_random(position[i]);
+        uint64_t second = next_random(position[i]);
+        double new_pipe_1_y = pipe_opening_y(to_unit(first));
+        double new_pipe_2_y = pipe_opening_y(to_unit(second));
+
+        // Move pipes to the left
+        double x = p1x[i] - F::flappy_speed * F::dt;
+        bool wrap = x < 0.0;
+        x = wrap ? x + F::pipe_distance * 2.0 : x;
+        double pipe_1 = wrap ? new_pipe_1_y : p1y[i];
+        double gap = x - F::pipe_distance;
+        double pipe_2 = (gap < 0.0) & (gap >= -F::flappy_speed * F::dt) ? new_pipe_2_y : p2y[i];
+
+        // Collisions are checked against the openings before the step
+        double second_x = x + F::pipe_distance;
+        second_x = second_x > F::screen_width + F::pipe_width ?
+            second_x - F::pipe_distance * 2.0 : second_x;
+        bool collision = hits_pipe(y, x, p1y[i]) | hits_pipe(y, second_x, p2y[i])
+            | (y + F::flappy_radius >= F::screen_height)
+            | (y - F::flappy_radius <= 0.0);
+
+        // Done instances start the next episode right away
+        p1x[i] = collision ?
+            F::flappy_x - F::flappy_radius + double(first & 1) * F::pipe_distance : x;
+        p1y[i] = collision ? new_pipe_1_y : pipe_1;
+        p2y[i] = collision ? new_pipe_2_y : pipe_2;
+        fy[i] = collision ? F::screen_height / 2.0 : y;
+        fv[i] = collision ? 0.0 : v;
+        done_out[i] = collision;
+    }
+    observe(observations);
+}
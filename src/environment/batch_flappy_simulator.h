@@ -0,0 +1,66 @@
+#ifndef __BATCH_FLAPPY_SIMULATOR_H_
+#define __BATCH_FLAPPY_SIMULATOR_H_
+
+#include "src/environment/batch_environment.h"
+#include "src/environment/flappy_simulator.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Simulates many FlappySimulator instances at once. The state is kept
+ *        as structure of arrays (one contiguous array per state entry), the
+ *        physics, the collision tests and the resets are computed without
+ *        branches for all instances, so the compiler can vectorize the
+ *        loops. That needs -O3 and a -march with AVX-512DQ, the 64-bit
+ *        multiplies of the random streams keep the loop scalar otherwise.
+ *        Each instance draws its random numbers from its own stream, the
+ *        same seed reproduces the same episodes.
+ */
+class BatchFlappySimulator final : public BatchEnvironment {
+  public:
+    /**
+     * @brief Construct a new batch of Flappy simulators
+     *
+     * @param batch_size Number of instances
+     * @param seed Seed of the random streams, 0 takes the clock
+     */
+    explicit BatchFlappySimulator(int batch_size, uint64_t seed = 0);
+
+    int getNumberOfActions() override { return FlappySimulator::NUMBER_OF_ACTIONS; }
+
+    int getStateDim() override { return FlappySimulator::SIZE_OF_STATESPACE; }
+
+    int getBatchSize() override { return batch_size; }
+
+    /**
+     * @brief Get the states of all instances
+     *
+     * @return Eigen::MatrixXd, one column per instance
+     */
+    Eigen::MatrixXd getStates() const;
+
+    void step(
+        const Eigen::Ref<const Eigen::VectorXi>& actions,
+        Eigen::Ref<Eigen::MatrixXd> observations,
+        Eigen::Ref<Eigen::VectorXi> done) override;
+
+    void reset(Eigen::Ref<Eigen::MatrixXd> observations) override;
+
+  private:
+    int batch_size;                 //<! Number of instances
+    std::vector<double> pipe_1_x;   //<! Horizontal position of the first pipe
+    std::vector<double> pipe_1_y;   //<! Opening of the first pipe
+    std::vector<double> pipe_2_y;   //<! Opening of the second pipe
+    std::vector<double> flappy_y;   //<! Vertical position of the bird
+    std::vector<double> flappy_v;   //<! Vertical velocity of the bird
+    std::vector<uint64_t> random;   //<! Position of each random stream
+
+    /**
+     * @brief Copies the states into the observation matrix
+     *
+     * @param observations Output of the observations, one column per instance
+     */
+    void observe(Eigen::Ref<Eigen::MatrixXd> observations) const;
+};
+
+#endif
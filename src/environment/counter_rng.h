@@ -0,0 +1,98 @@
+#ifndef __COUNTER_RNG_H_
+#define __COUNTER_RNG_H_
+
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief Counter-based random number generator (Philox4x32-10). Every number
+ *        is a keyed hash of its position, so generators share no state, take
+ *        no locks and the stream of a (seed, stream) pair is reproducible.
+ *        Different streams of the same seed are independent.
+ */
+class CounterRng {
+  public:
+    typedef uint64_t result_type; //<! Type of the generated numbers
+
+    /**
+     * @brief Construct a new generator
+     *
+     * @param seed Seed of the run, the key of the hash
+     * @param stream Number of the stream, e.g. the episode index
+     */
+    explicit CounterRng(uint64_t seed = 0, uint64_t stream = 0) {
+        this->seed(seed, stream);
+    }
+
+    /**
+     * @brief Restarts the generator at the beginning of a stream
+     *
+     * @param seed Seed of the run, the key of the hash
+     * @param stream Number of the stream, e.g. the episode index
+     */
+    void seed(uint64_t seed, uint64_t stream) {
+        key = {uint32_t(seed), uint32_t(seed >> 32)};
+        counter = {0, 0, uint32_t(stream), uint32_t(stream >> 32)};
+        available = 0;
+    }
+
+    static constexpr result_type min() { return 0; }
+
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    /**
+     * @brief Get the next 64 random bits
+     *
+     * @return uint64_t
+     */
+    result_type operator()() {
+        if (available == 0) {
+            block = philox(counter, key);
+            // 64-bit position in the stream
+            if (++counter[0] == 0) ++counter[1];
+            available = 2;
+        }
+        available--;
+        return (uint64_t(block[2 * available + 1]) << 32) | block[2 * available];
+    }
+
+    /**
+     * @brief Get a uniformly distributed value in [0, 1)
+     *
+     * @return double
+     */
+    double uniform() {
+        return double((*this)() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * @brief Philox4x32 with 10 rounds
+     *
+     * @param counter Position of the block
+     * @param key Key of the hash
+     * @return Four random 32-bit words
+     */
+    static std::array<uint32_t, 4> philox(
+        std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key) {
+        for (int round = 0; round < 10; round++) {
+            const uint64_t product_0 = uint64_t(0xD2511F53u) * counter[0];
+            const uint64_t product_1 = uint64_t(0xCD9E8D57u) * counter[2];
+            counter = {
+                uint32_t(product_1 >> 32) ^ counter[1] ^ key[0],
+                uint32_t(product_1),
+                uint32_t(product_0 >> 32) ^ counter[3] ^ key[1],
+                uint32_t(product_0)};
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+        return counter;
+    }
+
+  private:
+    std::array<uint32_t, 2> key;     //<! Seed
+    std::array<uint32_t, 4> counter; //<! Position (low words) and stream (high words)
+    std::array<uint32_t, 4> block;   //<! Last generated block
+    int available;                   //<! Unused 64-bit values of the block
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define __ENVIRONMENT_HPP
 
 #include "Eigen/Dense"
+#include "src/environment/counter_rng.h"
+#include <random>
 #include <string>
 
 /**
@@ -10,8 +12,22 @@
  * 
  */
 class Environment {
+  protected:
+    CounterRng random; //<! Random numbers of this environment instance
+
   public:
-    Environment() {} 
+    Environment() : random(std::random_device()()) {} 
+
+    virtual ~Environment() {}
+
+    /**
+     * @brief Selects the random numbers of the next episodes. The same seed
+     *        and stream reproduce the same episodes.
+     * 
+     * @param run_seed Seed of the run
+     * @param stream Stream of this instance, e.g. the episode index
+     */
+    void seed(uint64_t run_seed, uint64_t stream) { random.seed(run_seed, stream); }
 
     /**
      * @brief Get the Number Of possible discrete Actions 
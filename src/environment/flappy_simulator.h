@@ -2,29 +2,22 @@
 #define __FLAPPY_SIMULATOR_H_
 
 #include "src/environment/environment.h"
-#include "src/policy/policy.h"
-#include "SDL.h"
-#include <chrono>
+#include "src/render/scene.h"
 #include <cstdlib>
 #include <iostream>
 
-class FlappySimulator : public Environment {
+class FlappySimulator final : public Environment {
   private:
-    SDL_Window* window;
-    SDL_Surface* window_surface;
-
     Eigen::VectorXd state;
     bool collision;
 
-    // Call this before generating random data
-    void randomizeSeed();
-
     // Source: https://www.geeksforgeeks.org/check-if-any-point-overlaps-the-given-circle-and-rectangle/
     bool checkOverlap(double R, double Xc, double Yc,
       double X1, double Y1, double X2, double Y2);
 
   public:
     static const int SIZE_OF_STATESPACE = 5;
+    static const int NUMBER_OF_ACTIONS = 2;
     static const int PIPE_1_X = 0;
     static const int PIPE_1_Y = 1;
     static const int PIPE_2_Y = 2;
@@ -45,21 +38,24 @@ class FlappySimulator : public Environment {
     static constexpr double gravity       = 9.81;
     static constexpr double dt            = 1.0 / 20.0;
 
-    FlappySimulator(bool with_gui = false);
-
-    ~FlappySimulator();
+    FlappySimulator();
 
-    void render(std::string mode="graphic");
+    void render(std::string mode="console");
 
-    void play(std::shared_ptr<Policy> policy, double play_time_sec = 10.0, double speedup = 1.0);
+    /**
+     * @brief Get the current frame, drawn by a renderer
+     * 
+     * @return Scene 
+     */
+    Scene getScene() const;
 
-    int getNumberOfActions() { return 2; }
+    int getNumberOfActions() { return NUMBER_OF_ACTIONS; }
     
     int getStateDim() { return SIZE_OF_STATESPACE; }
 
     Eigen::VectorXd getState() { return state; }
 
-    bool getCollision() { return collision; }
+    bool getCollision() const { return collision; }
 
     void step(int action, Eigen::Ref<Eigen::VectorXd> observation, bool& done);
 
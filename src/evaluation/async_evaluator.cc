@@ -0,0 +1,157 @@
+#include "src/evaluation/async_evaluator.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+AsyncEvaluator::AsyncEvaluator(
+        const std::shared_ptr<Approximator>& approximator,
+        const approximator_function& approximator_generator,
+        Learner::environment_function environment_generator,
+        Learner::reward_function reward,
+        int episodes,
+        int max_steps,
+        uint64_t seed)
+    : approximator(approximator),
+      replica(approximator_generator()),
+      environment_generator(std::move(environment_generator)),
+      reward(std::move(reward)),
+      episodes(episodes),
+      max_steps(max_steps),
+      seed(seed),
+      staged(false),
+      staged_batch(0),
+      copying(false),
+      updating(false),
+      skipped(0),
+      busy(false),
+      stop(false) {
+    WeightTable* weights = approximator->weight_table();
+    WeightTable* replica_weights = replica->weight_table();
+    if (!weights || !replica_weights)
+        throw std::logic_error("Approximator has no weight table.");
+    if (weights->size() != replica_weights->size())
+        throw std::invalid_argument("Replica does not match the approximator.");
+    if (episodes <= 0 || max_steps <= 0)
+        throw std::invalid_argument("Number of episodes and steps must be positive.");
+    // The staging buffer starts as a full copy, later submits copy the
+    // changed blocks only
+    tracker = approximator->track_changes();
+    staging.assign(weights->data(), weights->data() + weights->size());
+    worker = std::thread(&AsyncEvaluator::run, this);
+}
+
+AsyncEvaluator::~AsyncEvaluator() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return !staged && !copying && !busy; });
+        stop = true;
+    }
+    condition.notify_all();
+    worker.join();
+    approximator->stop_tracking(tracker);
+}
+
+void AsyncEvaluator::submit(int batch) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        // The background thread reads the staging buffer, this snapshot is
+        // skipped and its changes stay marked for the next one
+        if (copying) {
+            skipped++;
+            return;
+        }
+        // The staged snapshot is outdated, the new one takes its buffer
+        if (staged) skipped++;
+        staged = false;
+        updating = true;
+    }
+
+    // Blocks changed since the last submit, all threads copy a part
+    WeightTable* weights = approximator->weight_table();
+    const std::vector<std::size_t> blocks = weights->take_changed_blocks(tracker);
+    const float* source = weights->data();
+    float* snapshot = staging.data();
+    const std::size_t size = staging.size();
+    const int count = int(blocks.size());
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < count; i++) {
+        const std::size_t first = blocks[i] * WeightTable::BLOCK_SIZE;
+        const std::size_t last = std::min(size, first + WeightTable::BLOCK_SIZE);
+        std::memcpy(snapshot + first, source + first, (last - first) * sizeof(float));
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    updating = false;
+    staged = true;
+    staged_batch = batch;
+    condition.notify_all();
+}
+
+std::vector<EvaluationResult> AsyncEvaluator::take_results() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!error.empty()) {
+        std::string message;
+        std::swap(message, error);
+        throw std::runtime_error(message);
+    }
+    std::vector<EvaluationResult> finished;
+    std::swap(finished, results);
+    return finished;
+}
+
+void AsyncEvaluator::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return !staged && !copying && !busy; });
+}
+
+int AsyncEvaluator::getSkipped() {
+    std::unique_lock<std::mutex> lock(mutex);
+    return skipped;
+}
+
+void AsyncEvaluator::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this] { return (staged && !updating) || stop; });
+        if (!staged || updating) return;
+        const int batch = staged_batch;
+        copying = true;
+        busy = true;
+        lock.unlock();
+
+        // The replica is private to this thread, learners keep running
+        WeightTable* replica_weights = replica->weight_table();
+        std::memcpy(replica_weights->data(), staging.data(),
+            staging.size() * sizeof(float));
+        lock.lock();
+        copying = false;
+        staged = false;
+        condition.notify_all();
+        lock.unlock();
+
+        EvaluationResult result = {};
+        std::string message;
+        try {
+            // A single thread, the learners keep the cores
+            Evaluation evaluation = Evaluation::play(*replica, environment_generator,
+                reward, episodes, max_steps, seed, false);
+            Distribution length = evaluation.length_distribution();
+            result.batch = batch;
+            result.episodes = episodes;
+            result.mean_reward = evaluation.reward_distribution().mean;
+            result.mean_length = length.mean;
+            result.max_length = length.max;
+        } catch (const std::exception& e) {
+            message = e.what();
+        }
+
+        lock.lock();
+        if (message.empty()) {
+            results.push_back(result);
+        } else {
+            error = message;
+        }
+        busy = false;
+        condition.notify_all();
+    }
+}
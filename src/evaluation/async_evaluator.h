@@ -0,0 +1,140 @@
+#ifndef __ASYNC_EVALUATOR_H_
+#define __ASYNC_EVALUATOR_H_
+
+#include "src/approximator/approximator.h"
+#include "src/evaluation/evaluation.h"
+#include "src/learner/learner.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Result of the evaluation of one snapshot
+ */
+struct EvaluationResult {
+    int batch;          //<! Batch after which the snapshot was taken
+    int episodes;       //<! Number of evaluation episodes
+    double mean_reward; //<! Mean total reward per episode
+    double mean_length; //<! Mean number of steps per episode
+    double max_length;  //<! Longest episode
+};
+
+/**
+ * @brief Evaluates the greedy policy of an approximator on a background
+ *        thread while the learners continue. The staging buffer mirrors the
+ *        weights: submit copies only the blocks changed since the previous
+ *        submit (change tracking of the weight table), so the stall of the
+ *        caller is proportional to the changed part of the table. The
+ *        background thread copies the staged snapshot into its own replica
+ *        of the approximator and plays the evaluation episodes on it. The
+ *        live weights are never read by the background thread. Replica and
+ *        staging buffer hold two extra copies of the table in RAM, which
+ *        does not suit tables larger than RAM.
+ *
+ *        Every evaluation plays the same seeded episodes, so the results of
+ *        different batches are comparable. submit never waits for the
+ *        background thread: while it copies the staging buffer the new
+ *        snapshot is skipped (its changes go into the next one), and a
+ *        staged snapshot which was not picked up yet is replaced.
+ */
+class AsyncEvaluator {
+  public:
+    typedef std::function<std::shared_ptr<Approximator>(void)> approximator_function; //!> Approximator function, provides an approximator with the layout of the evaluated one
+
+    /**
+     * @brief Construct a new asynchronous evaluator and start the background
+     *        thread
+     *
+     * @param approximator Approximator to evaluate, must have a weight table
+     * @param approximator_generator Function that generates the replica
+     * @param environment_generator Function that generates the evaluation environments
+     * @param reward Reward function
+     * @param episodes Number of episodes per evaluation
+     * @param max_steps Maximum number of steps per episode
+     * @param seed Seed of the evaluation episodes, episode i uses stream i
+     */
+    AsyncEvaluator(
+        const std::shared_ptr<Approximator>& approximator,
+        const approximator_function& approximator_generator,
+        Learner::environment_function environment_generator,
+        Learner::reward_function reward,
+        int episodes = 10,
+        int max_steps = 1000,
+        uint64_t seed = 1);
+
+    /**
+     * @brief Waits for the background thread to finish its evaluation
+     *
+     */
+    ~AsyncEvaluator();
+
+    /**
+     * @brief Takes a snapshot of the weights and evaluates it in the
+     *        background. Learners must not update the weights during the
+     *        call, which must not be made from inside a parallel region.
+     *
+     * @param batch Batch the snapshot belongs to
+     */
+    void submit(int batch);
+
+    /**
+     * @brief Get the finished evaluations since the last call, without
+     *        blocking. Rethrows an error of the background thread.
+     *
+     * @return std::vector<EvaluationResult>
+     */
+    std::vector<EvaluationResult> take_results();
+
+    /**
+     * @brief Blocks until all submitted snapshots are evaluated or skipped
+     *
+     */
+    void wait();
+
+    /**
+     * @brief Get the number of snapshots which were replaced by newer ones
+     *        before their evaluation or dropped while the background thread
+     *        copied the previous one
+     *
+     * @return int
+     */
+    int getSkipped();
+
+  private:
+    std::shared_ptr<Approximator> approximator; //<! Approximator to evaluate
+    std::shared_ptr<Approximator> replica;      //<! Approximator of the background thread
+    Learner::environment_function environment_generator; //<! Environment generator function
+    Learner::reward_function reward;            //<! Reward function
+    int episodes;                               //<! Number of episodes per evaluation
+    int max_steps;                              //<! Maximum number of steps per episode
+    uint64_t seed;                              //<! Seed of the evaluation episodes
+
+    std::vector<float> staging;                 //<! Mirror of the weights as of the last submit
+    int tracker;                                //<! Change tracker of the weights since the last submit
+
+    std::mutex mutex;                       //<! Protects the following members
+    std::condition_variable condition;      //<! Signals new snapshots and finished evaluations
+    bool staged;                            //<! Staging buffer holds a complete snapshot
+    int staged_batch;                       //<! Batch of the staged snapshot
+    bool copying;                           //<! Background thread reads the staging buffer
+    bool updating;                          //<! submit writes the staging buffer
+    std::vector<EvaluationResult> results;  //<! Finished evaluations
+    int skipped;                            //<! Snapshots replaced before their evaluation
+    bool busy;                              //<! Background thread evaluates a snapshot
+    bool stop;                              //<! Background thread has to quit
+    std::string error;                      //<! Error message of the last evaluation
+    std::thread worker;                     //<! Background thread
+
+    /**
+     * @brief Main loop of the background thread
+     *
+     */
+    void run();
+};
+
+#endif
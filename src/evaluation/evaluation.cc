@@ -0,0 +1,63 @@
+#include "src/evaluation/evaluation.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+Evaluation Evaluation::play(
+        Approximator& approximator,
+        const Learner::environment_function& environment_generator,
+        const Learner::reward_function& reward,
+        int episodes, int max_steps, uint64_t seed,
+        bool parallel) {
+    if (episodes <= 0 || max_steps <= 0)
+        throw std::invalid_argument("Number of episodes and steps must be positive.");
+    Evaluation evaluation;
+    evaluation.rewards.resize(episodes);
+    evaluation.lengths.resize(episodes);
+
+    // Nothing writes the weights, readers need no locks
+    const ConcurrencyMode concurrency_mode = approximator.concurrency_mode;
+    if (concurrency_mode == ConcurrencyMode::LOCKED)
+        approximator.concurrency_mode = ConcurrencyMode::HOGWILD;
+    #pragma omp parallel for schedule(dynamic, 1) if(parallel)
+    for (int episode=0; episode < episodes; episode++) {
+        auto environment = environment_generator();
+        environment->seed(seed, episode);
+        Eigen::VectorXd state = Eigen::VectorXd::Zero(environment->getStateDim());
+        Eigen::VectorXd next_state = Eigen::VectorXd::Zero(environment->getStateDim());
+        environment->reset(state);
+        double total_reward = 0.0;
+        int length = 0;
+        bool done = false;
+        while (!done && length < max_steps) {
+            int action = approximator.greedy_action(state);
+            environment->step(action, next_state, done);
+            total_reward += reward(state, action, next_state, environment.get());
+            state.swap(next_state);
+            length++;
+        }
+        evaluation.rewards[episode] = total_reward;
+        evaluation.lengths[episode] = length;
+    }
+    approximator.concurrency_mode = concurrency_mode;
+    return evaluation;
+}
+
+Distribution Evaluation::summarize(std::vector<double> values) {
+    if (values.empty())
+        throw std::invalid_argument("Sample is empty.");
+    std::sort(values.begin(), values.end());
+    auto percentile = [&values](double p) {
+        // Smallest value with at least p percent of the sample below or equal
+        std::size_t rank = std::size_t(std::ceil(p / 100.0 * values.size()));
+        return values[std::max<std::size_t>(rank, 1) - 1];
+    };
+    Distribution distribution;
+    distribution.mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    distribution.p50 = percentile(50.0);
+    distribution.p90 = percentile(90.0);
+    distribution.p99 = percentile(99.0);
+    distribution.max = values.back();
+    return distribution;
+}
@@ -0,0 +1,73 @@
+#ifndef __EVALUATION_H_
+#define __EVALUATION_H_
+
+#include "src/approximator/approximator.h"
+#include "src/learner/learner.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Summary of a sample, percentiles use the nearest rank
+ */
+struct Distribution {
+    double mean; //<! Mean value
+    double p50;  //<! Median
+    double p90;  //<! 90th percentile
+    double p99;  //<! 99th percentile
+    double max;  //<! Largest value
+};
+
+/**
+ * @brief Outcome of greedy episodes without rendering. Episode i is seeded
+ *        with stream i of the seed, so the outcome does not depend on the
+ *        number of threads.
+ */
+class Evaluation {
+  public:
+    std::vector<double> rewards; //<! Total reward of each episode
+    std::vector<double> lengths; //<! Number of steps of each episode
+
+    /**
+     * @brief Plays greedy episodes with an approximator. The weights are only
+     *        read, parallel episodes do not lock the approximator.
+     *
+     * @param approximator Approximator which selects the actions
+     * @param environment_generator Function that generates the environments
+     * @param reward Reward function
+     * @param episodes Number of episodes
+     * @param max_steps Maximum number of steps per episode
+     * @param seed Seed of the episodes, episode i uses stream i
+     * @param parallel Distribute the episodes over all cores
+     * @return Evaluation
+     */
+    static Evaluation play(
+        Approximator& approximator,
+        const Learner::environment_function& environment_generator,
+        const Learner::reward_function& reward,
+        int episodes, int max_steps, uint64_t seed,
+        bool parallel = true);
+
+    /**
+     * @brief Get the distribution of the episode rewards
+     *
+     * @return Distribution
+     */
+    Distribution reward_distribution() const { return summarize(rewards); }
+
+    /**
+     * @brief Get the distribution of the episode lengths
+     *
+     * @return Distribution
+     */
+    Distribution length_distribution() const { return summarize(lengths); }
+
+    /**
+     * @brief Summarizes a sample
+     *
+     * @param values Sample, must not be empty
+     * @return Distribution
+     */
+    static Distribution summarize(std::vector<double> values);
+};
+
+#endif
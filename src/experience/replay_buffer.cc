@@ -0,0 +1,87 @@
+#include "src/experience/replay_buffer.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+ReplayBuffer::ReplayBuffer(int capacity, int state_dim,
+        double alpha, double beta, double epsilon)
+    : alpha(alpha), beta(beta), epsilon(epsilon),
+      state_dim(state_dim),
+      states(Eigen::MatrixXd::Zero(state_dim, capacity)),
+      next_states(Eigen::MatrixXd::Zero(state_dim, capacity)),
+      actions(capacity, 0),
+      rewards(capacity, 0.0),
+      terminals(capacity, false),
+      stamps(capacity, 0),
+      priorities(capacity),
+      max_priority(1.0),
+      inserted(0) {
+    if (capacity <= 0 || state_dim <= 0)
+        throw std::invalid_argument("Capacity and state size must be positive.");
+}
+
+void ReplayBuffer::add(ReplayStage& stage) {
+    if (stage.size > 0 && stage.states.rows() != state_dim)
+        throw std::invalid_argument("Staged states have the wrong size.");
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int i=0; i < stage.size; i++) {
+        const std::size_t slot = inserted % actions.size();
+        states.col(slot) = stage.states.col(i);
+        next_states.col(slot) = stage.next_states.col(i);
+        actions[slot] = stage.actions[i];
+        rewards[slot] = stage.rewards[i];
+        terminals[slot] = stage.terminals[i];
+        stamps[slot] = inserted++;
+        // Sampled at least once before its error is known
+        priorities.set(slot, max_priority);
+    }
+    stage.size = 0;
+}
+
+int ReplayBuffer::sample(int count, CounterRng& random, ReplayBatch& batch) {
+    if (count > batch.capacity())
+        throw std::invalid_argument("Batch is too small.");
+    std::lock_guard<std::mutex> lock(mutex);
+    const double stored = double(std::min<uint64_t>(inserted, actions.size()));
+    const double total = priorities.total();
+    batch.size = 0;
+    if (stored == 0 || total <= 0.0) return 0;
+
+    // One sample from each of count equal parts of the priority mass
+    const double segment = total / count;
+    double max_weight = 0.0;
+    for (int i=0; i < count; i++) {
+        double value = std::min((i + random.uniform()) * segment, std::nextafter(total, 0.0));
+        std::size_t slot = priorities.find(value);
+        batch.states.col(i) = states.col(slot);
+        batch.next_states.col(i) = next_states.col(slot);
+        batch.actions[i] = actions[slot];
+        batch.rewards[i] = rewards[slot];
+        batch.terminals[i] = terminals[slot];
+        batch.slots[i] = slot;
+        batch.stamps[i] = stamps[slot];
+        // Corrects the bias of the non-uniform sampling
+        double probability = priorities.get(slot) / total;
+        batch.weights[i] = std::pow(stored * probability, -beta);
+        max_weight = std::max(max_weight, batch.weights[i]);
+    }
+    for (int i=0; i < count; i++) batch.weights[i] /= max_weight;
+    batch.size = count;
+    return count;
+}
+
+void ReplayBuffer::update_priorities(const ReplayBatch& batch, const double* errors) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int i=0; i < batch.size; i++) {
+        // The slot holds a newer transition
+        if (stamps[batch.slots[i]] != batch.stamps[i]) continue;
+        double priority = std::pow(std::abs(errors[i]) + epsilon, alpha);
+        max_priority = std::max(max_priority, priority);
+        priorities.set(batch.slots[i], priority);
+    }
+}
+
+int ReplayBuffer::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return int(std::min<uint64_t>(inserted, actions.size()));
+}
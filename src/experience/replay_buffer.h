@@ -0,0 +1,199 @@
+#ifndef __REPLAY_BUFFER_H_
+#define __REPLAY_BUFFER_H_
+
+#include "src/environment/counter_rng.h"
+#include "src/experience/sum_tree.h"
+#include "Eigen/Dense"
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Transitions sampled from a replay buffer, copied so that other
+ *        threads can overwrite the slots meanwhile. Allocated once by the
+ *        caller and reused.
+ */
+struct ReplayBatch {
+    int size = 0;                     //<! Number of sampled transitions
+    Eigen::MatrixXd states;           //<! State of each transition (columns)
+    Eigen::MatrixXd next_states;      //<! Next state of each transition (columns)
+    std::vector<int> actions;         //<! Action of each transition
+    std::vector<double> rewards;      //<! Reward of each transition
+    std::vector<bool> terminals;      //<! Next state is a final state
+    std::vector<double> weights;      //<! Importance sampling weight, at most 1
+    std::vector<std::size_t> slots;   //<! Slot of each transition in the buffer
+    std::vector<uint64_t> stamps;     //<! Insertion number of each transition
+
+    /**
+     * @brief Allocates the buffers
+     *
+     * @param capacity Maximum number of transitions
+     * @param state_dim Size of the state vectors
+     */
+    void reserve(int capacity, int state_dim) {
+        states.resize(state_dim, capacity);
+        next_states.resize(state_dim, capacity);
+        actions.resize(capacity);
+        rewards.resize(capacity);
+        terminals.resize(capacity);
+        weights.resize(capacity);
+        slots.resize(capacity);
+        stamps.resize(capacity);
+    }
+
+    /**
+     * @brief Get the maximum number of transitions
+     *
+     * @return int
+     */
+    int capacity() const { return int(actions.size()); }
+};
+
+/**
+ * @brief Transitions of one thread waiting to be added to a replay buffer,
+ *        so that the buffer is locked once per stage instead of once per
+ *        step. Allocated once by the caller and reused.
+ */
+struct ReplayStage {
+    int size = 0;                     //<! Number of staged transitions
+    Eigen::MatrixXd states;           //<! State of each transition (columns)
+    Eigen::MatrixXd next_states;      //<! Next state of each transition (columns)
+    std::vector<int> actions;         //<! Action of each transition
+    std::vector<double> rewards;      //<! Reward of each transition
+    std::vector<bool> terminals;      //<! Next state is a final state
+
+    /**
+     * @brief Allocates the buffers and empties the stage
+     *
+     * @param capacity Maximum number of transitions
+     * @param state_dim Size of the state vectors
+     */
+    void reserve(int capacity, int state_dim) {
+        size = 0;
+        states.resize(state_dim, capacity);
+        next_states.resize(state_dim, capacity);
+        actions.resize(capacity);
+        rewards.resize(capacity);
+        terminals.resize(capacity);
+    }
+
+    /**
+     * @brief Get the maximum number of transitions
+     *
+     * @return int
+     */
+    int capacity() const { return int(actions.size()); }
+
+    /**
+     * @brief Check whether the stage must be added before the next push
+     *
+     * @return bool
+     */
+    bool full() const { return size == capacity(); }
+
+    /**
+     * @brief Appends a transition, the stage must not be full
+     *
+     * @param state State vector with state_dim values
+     * @param action Action taken in the state
+     * @param reward Reward of the transition
+     * @param next_state Next state vector with state_dim values
+     * @param terminal Next state is a final state
+     */
+    void push(const double* state, int action, double reward,
+            const double* next_state, bool terminal) {
+        states.col(size) = Eigen::Map<const Eigen::VectorXd>(state, states.rows());
+        next_states.col(size) = Eigen::Map<const Eigen::VectorXd>(next_state, states.rows());
+        actions[size] = action;
+        rewards[size] = reward;
+        terminals[size] = terminal;
+        size++;
+    }
+};
+
+/**
+ * @brief Fixed-capacity prioritized replay buffer. Transitions are stored in
+ *        a ring of preallocated slots, the oldest one is overwritten when the
+ *        buffer is full, so there are no allocations after the construction.
+ *        Transitions are sampled with probability proportional to
+ *        priority^alpha through a sum-tree, new transitions get the highest
+ *        priority seen so far. All methods lock the buffer and may be called
+ *        from the OpenMP workers concurrently; the workers stage their
+ *        transitions and add them in groups to keep the lock uncontended.
+ */
+class ReplayBuffer {
+  public:
+    const double alpha;   //<! How strongly priorities shape the sampling, 0 is uniform
+    const double beta;    //<! Strength of the importance sampling correction, 1 is full
+    const double epsilon; //<! Added to priorities, keeps every transition reachable
+
+    /**
+     * @brief Construct a new replay buffer
+     *
+     * @param capacity Number of slots
+     * @param state_dim Size of the state vectors
+     * @param alpha Priority exponent
+     * @param beta Importance sampling exponent
+     * @param epsilon Smallest priority
+     */
+    ReplayBuffer(int capacity, int state_dim,
+        double alpha = 0.6, double beta = 0.4, double epsilon = 1e-3);
+
+    /**
+     * @brief Stores the staged transitions in the next slots with a single
+     *        lock and empties the stage
+     *
+     * @param stage Transitions of the calling thread
+     */
+    void add(ReplayStage& stage);
+
+    /**
+     * @brief Samples transitions proportional to their priority, with
+     *        replacement
+     *
+     * @param count Number of transitions, at most the capacity of the batch
+     * @param random Random number generator of the calling thread
+     * @param batch Output of the transitions
+     * @return Number of sampled transitions, 0 if the buffer is empty
+     */
+    int sample(int count, CounterRng& random, ReplayBatch& batch);
+
+    /**
+     * @brief Sets the priorities of sampled transitions from their errors.
+     *        Transitions which were overwritten since the sampling are
+     *        skipped.
+     *
+     * @param batch Sampled transitions
+     * @param errors Value error of each transition
+     */
+    void update_priorities(const ReplayBatch& batch, const double* errors);
+
+    /**
+     * @brief Get the number of stored transitions
+     *
+     * @return int
+     */
+    int size();
+
+    /**
+     * @brief Get the number of slots
+     *
+     * @return int
+     */
+    int capacity() const { return int(actions.size()); }
+
+  private:
+    int state_dim;                    //<! Size of the state vectors
+    Eigen::MatrixXd states;           //<! State of each slot (columns)
+    Eigen::MatrixXd next_states;      //<! Next state of each slot (columns)
+    std::vector<int> actions;         //<! Action of each slot
+    std::vector<double> rewards;      //<! Reward of each slot
+    std::vector<bool> terminals;      //<! Final state flag of each slot
+    std::vector<uint64_t> stamps;     //<! Insertion number of each slot
+    SumTree priorities;               //<! priority^alpha of each slot
+    double max_priority;              //<! Highest priority so far
+    uint64_t inserted;                //<! Number of added transitions
+    std::mutex mutex;                 //<! Serializes all accesses
+};
+
+#endif
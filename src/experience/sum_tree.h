@@ -0,0 +1,81 @@
+#ifndef __SUM_TREE_H_
+#define __SUM_TREE_H_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Binary tree whose leaves hold non-negative priorities and whose
+ *        inner nodes hold the sums of their children. Changing a priority
+ *        and finding the leaf of a prefix sum take O(log N), which makes
+ *        sampling proportional to the priorities cheap. The tree is stored
+ *        as an array, node i has the children 2i and 2i+1, the root is 1.
+ */
+class SumTree {
+  public:
+    /**
+     * @brief Construct a new sum tree with all priorities zero
+     *
+     * @param capacity Number of leaves
+     */
+    explicit SumTree(std::size_t capacity = 0) : leaves(1) {
+        while (leaves < capacity) leaves *= 2;
+        nodes.assign(2 * leaves, 0.0);
+    }
+
+    /**
+     * @brief Get the sum of all priorities
+     *
+     * @return double
+     */
+    double total() const { return nodes[1]; }
+
+    /**
+     * @brief Get the priority of a leaf
+     *
+     * @param index Leaf number
+     * @return double
+     */
+    double get(std::size_t index) const { return nodes[leaves + index]; }
+
+    /**
+     * @brief Changes the priority of a leaf and the sums above it
+     *
+     * @param index Leaf number
+     * @param priority New priority, must not be negative
+     */
+    void set(std::size_t index, double priority) {
+        std::size_t node = leaves + index;
+        nodes[node] = priority;
+        // Sums are recomputed instead of adjusted, so rounding errors do not add up
+        for (node /= 2; node >= 1; node /= 2) nodes[node] = nodes[2 * node] + nodes[2 * node + 1];
+    }
+
+    /**
+     * @brief Finds the leaf where the running sum of the priorities
+     *        exceeds a value
+     *
+     * @param value Value in [0, total())
+     * @return Leaf number
+     */
+    std::size_t find(double value) const {
+        std::size_t node = 1;
+        while (node < leaves) {
+            // Go right if the left subtree does not reach the value
+            std::size_t left = 2 * node;
+            if (value < nodes[left] || nodes[left + 1] <= 0.0) {
+                node = left;
+            } else {
+                value -= nodes[left];
+                node = left + 1;
+            }
+        }
+        return node - leaves;
+    }
+
+  private:
+    std::size_t leaves;        //<! Number of leaves, a power of two
+    std::vector<double> nodes; //<! Sums of the subtrees, leaves start at index leaves
+};
+
+#endif
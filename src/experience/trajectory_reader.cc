@@ -0,0 +1,67 @@
+#include "src/experience/trajectory_reader.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TrajectoryReader::TrajectoryReader(const std::string& filename)
+    : state_dim(0), record_size(0), memory(nullptr), length(0) {
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0) throw std::runtime_error("Cannot open trajectory " + filename);
+    struct stat status;
+    if (fstat(file, &status) != 0 || std::size_t(status.st_size) < sizeof(TrajectoryFormat::FileHeader)) {
+        close(file);
+        throw std::runtime_error("Not a trajectory file: " + filename);
+    }
+    length = std::size_t(status.st_size);
+    memory = mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (memory == MAP_FAILED) {
+        memory = nullptr;
+        throw std::runtime_error("Cannot map trajectory " + filename);
+    }
+    // Records are read in file order
+    madvise(memory, length, MADV_SEQUENTIAL);
+
+    const char* bytes = static_cast<const char*>(memory);
+    TrajectoryFormat::FileHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, "RLAGTRAJ", sizeof(header.magic)) != 0
+        || header.version != TrajectoryFormat::VERSION || header.state_dim == 0) {
+        munmap(memory, length);
+        memory = nullptr;
+        throw std::runtime_error("Not a trajectory file: " + filename);
+    }
+    state_dim = int(header.state_dim);
+    record_size = TrajectoryFormat::record_size(state_dim);
+
+    // Index of the complete chunks
+    const std::size_t record_bytes = record_size * sizeof(float);
+    std::size_t position = sizeof(header);
+    chunk_first.push_back(0);
+    while (position + sizeof(TrajectoryFormat::ChunkHeader) <= length) {
+        TrajectoryFormat::ChunkHeader chunk;
+        std::memcpy(&chunk, bytes + position, sizeof(chunk));
+        const std::size_t end = position + sizeof(chunk) + chunk.records * record_bytes;
+        if (chunk.magic != TrajectoryFormat::CHUNK_MAGIC || end > length) break;
+        chunk_data.push_back(reinterpret_cast<const float*>(bytes + position + sizeof(chunk)));
+        chunk_first.push_back(chunk_first.back() + chunk.records);
+        position = end;
+    }
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    if (memory) munmap(memory, length);
+}
+
+TrajectoryRecord TrajectoryReader::record(uint64_t index) const {
+    if (index >= size())
+        throw std::out_of_range("Record is out of range.");
+    // Last chunk which starts at or before the record
+    std::size_t chunk = std::upper_bound(chunk_first.begin(), chunk_first.end(), index)
+        - chunk_first.begin() - 1;
+    return chunk_record(chunk, index - chunk_first[chunk]);
+}
@@ -0,0 +1,115 @@
+#ifndef __TRAJECTORY_READER_H_
+#define __TRAJECTORY_READER_H_
+
+#include "src/experience/trajectory_writer.h"
+#include "Eigen/Dense"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief View of one record in a mapped trajectory file, valid as long as
+ *        the reader exists
+ */
+struct TrajectoryRecord {
+    const float* data; //<! First float of the record
+    int state_dim;     //<! Size of the state vectors
+
+    int action() const { return int(data[0]); }
+
+    float reward() const { return data[1]; }
+
+    TrajectoryEnd end() const { return TrajectoryEnd(int(data[2])); }
+
+    Eigen::Map<const Eigen::VectorXf> state() const {
+        return Eigen::Map<const Eigen::VectorXf>(
+            data + TrajectoryFormat::RECORD_HEADER, state_dim);
+    }
+
+    Eigen::Map<const Eigen::VectorXf> next_state() const {
+        return Eigen::Map<const Eigen::VectorXf>(
+            data + TrajectoryFormat::RECORD_HEADER + state_dim, state_dim);
+    }
+};
+
+/**
+ * @brief Reads a trajectory file without copies. The file is mapped read
+ *        only, the chunk headers are collected into an index on open and the
+ *        records are returned as views into the mapping. A torn chunk at the
+ *        end of the file (e.g. after a crash) is ignored.
+ */
+class TrajectoryReader {
+  public:
+    /**
+     * @brief Maps a trajectory file
+     *
+     * @param filename Trajectory file
+     */
+    explicit TrajectoryReader(const std::string& filename);
+
+    ~TrajectoryReader();
+
+    TrajectoryReader(const TrajectoryReader&) = delete;
+
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    /**
+     * @brief Get the size of the state vectors
+     *
+     * @return int
+     */
+    int getStateDim() const { return state_dim; }
+
+    /**
+     * @brief Get the number of records
+     *
+     * @return uint64_t
+     */
+    uint64_t size() const { return chunk_first.empty() ? 0 : chunk_first.back(); }
+
+    /**
+     * @brief Get the number of chunks
+     *
+     * @return std::size_t
+     */
+    std::size_t chunks() const { return chunk_data.size(); }
+
+    /**
+     * @brief Get the number of records of a chunk
+     *
+     * @param chunk Chunk number
+     * @return uint64_t
+     */
+    uint64_t chunk_records(std::size_t chunk) const {
+        return chunk_first[chunk + 1] - chunk_first[chunk];
+    }
+
+    /**
+     * @brief Get a record of a chunk, for sequential iteration
+     *
+     * @param chunk Chunk number
+     * @param index Record number within the chunk
+     * @return TrajectoryRecord
+     */
+    TrajectoryRecord chunk_record(std::size_t chunk, uint64_t index) const {
+        return {chunk_data[chunk] + index * record_size, state_dim};
+    }
+
+    /**
+     * @brief Get a record by its number in the file
+     *
+     * @param index Record number
+     * @return TrajectoryRecord
+     */
+    TrajectoryRecord record(uint64_t index) const;
+
+  private:
+    int state_dim;                        //<! Size of the state vectors
+    int record_size;                      //<! Floats per record
+    void* memory;                         //<! Mapping of the file
+    std::size_t length;                   //<! Size of the mapping
+    std::vector<const float*> chunk_data; //<! First record of each chunk
+    std::vector<uint64_t> chunk_first;    //<! Number of the first record of each chunk, plus the total
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "src/experience/trajectory_writer.h"
+#include <cstring>
+#include <filesystem>
+#include <omp.h>
+#include <stdexcept>
+
+namespace {
+const char FILE_MAGIC[8] = {'R', 'L', 'A', 'G', 'T', 'R', 'A', 'J'};
+
+// Size of the complete chunks of an existing file, a torn chunk at the end is dropped
+uint64_t valid_size(const std::string& filename, int state_dim) {
+    std::ifstream infile(filename, std::ios_base::binary | std::ios_base::ate);
+    const uint64_t size = uint64_t(infile.tellg());
+    infile.seekg(0);
+    TrajectoryFormat::FileHeader header;
+    infile.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!infile || std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+        || header.version != TrajectoryFormat::VERSION)
+        throw std::runtime_error("Not a trajectory file: " + filename);
+    if (header.state_dim != uint32_t(state_dim))
+        throw std::runtime_error("Trajectory file has another state size: " + filename);
+
+    const uint64_t record_bytes = TrajectoryFormat::record_size(state_dim) * sizeof(float);
+    uint64_t position = sizeof(header);
+    TrajectoryFormat::ChunkHeader chunk;
+    while (infile.read(reinterpret_cast<char*>(&chunk), sizeof(chunk))
+           && chunk.magic == TrajectoryFormat::CHUNK_MAGIC) {
+        uint64_t end = position + sizeof(chunk) + chunk.records * record_bytes;
+        if (end > size) break;
+        position = end;
+        infile.seekg(int64_t(position));
+    }
+    return position;
+}
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& filename, int state_dim, int chunk_records)
+    : filename(filename),
+      state_dim(state_dim),
+      record_size(TrajectoryFormat::record_size(state_dim)),
+      chunk_records(chunk_records),
+      buffered(0),
+      written(0) {
+    if (state_dim <= 0 || chunk_records <= 0)
+        throw std::invalid_argument("State size and chunk size must be positive.");
+    chunk.resize(std::size_t(chunk_records) * record_size);
+
+    // Appending continues behind the last complete chunk
+    const bool exists = std::filesystem::exists(filename)
+        && std::filesystem::file_size(filename) > 0;
+    if (exists) std::filesystem::resize_file(filename, valid_size(filename, state_dim));
+    outfile.open(filename, std::ios_base::binary | std::ios_base::app);
+    if (!exists) {
+        TrajectoryFormat::FileHeader header;
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header.version = TrajectoryFormat::VERSION;
+        header.state_dim = uint32_t(state_dim);
+        outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    if (!outfile)
+        throw std::runtime_error("Cannot write trajectory " + filename);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Destructors must not throw, the records of the last chunk are lost
+    }
+}
+
+void TrajectoryWriter::flush() {
+    if (buffered == 0) return;
+    TrajectoryFormat::ChunkHeader header;
+    header.magic = TrajectoryFormat::CHUNK_MAGIC;
+    header.records = uint32_t(buffered);
+    outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outfile.write(reinterpret_cast<const char*>(chunk.data()),
+        int64_t(std::size_t(buffered) * record_size * sizeof(float)));
+    outfile.flush();
+    if (!outfile)
+        throw std::runtime_error("Cannot write trajectory " + filename);
+    written += buffered;
+    buffered = 0;
+}
+
+TrajectoryRecorder::TrajectoryRecorder(const std::string& prefix, int state_dim, int chunk_records)
+    : prefix(prefix),
+      state_dim(state_dim),
+      chunk_records(chunk_records),
+      writers(omp_get_max_threads()) {}
+
+TrajectoryWriter& TrajectoryRecorder::writer() {
+    const int thread = omp_get_thread_num();
+    if (thread >= int(writers.size()))
+        throw std::logic_error("More threads than at the creation of the recorder.");
+    // Each thread only touches its own slot
+    if (!writers[thread])
+        writers[thread].reset(new TrajectoryWriter(filename(thread), state_dim, chunk_records));
+    return *writers[thread];
+}
+
+void TrajectoryRecorder::flush() {
+    for (auto& writer : writers) {
+        if (writer) writer->flush();
+    }
+}
+
+std::vector<std::string> TrajectoryRecorder::getFiles() const {
+    std::vector<std::string> files;
+    for (std::size_t thread = 0; thread < writers.size(); thread++) {
+        if (writers[thread]) files.push_back(filename(int(thread)));
+    }
+    return files;
+}
+
+uint64_t TrajectoryRecorder::getRecords() const {
+    uint64_t records = 0;
+    for (auto& writer : writers) {
+        if (writer) records += writer->getRecords();
+    }
+    return records;
+}
+
+std::string TrajectoryRecorder::filename(int thread) const {
+    return prefix + "_" + std::to_string(thread) + ".traj";
+}
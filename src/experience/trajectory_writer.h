@@ -0,0 +1,199 @@
+#ifndef __TRAJECTORY_WRITER_H_
+#define __TRAJECTORY_WRITER_H_
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief How a transition ends its episode, stored with each record
+ */
+enum class TrajectoryEnd {
+    NONE = 0,      //<! Episode continues
+    TERMINAL = 1,  //<! Next state is a final state
+    TRUNCATED = 2  //<! Episode ran out of steps
+};
+
+/**
+ * @brief Layout of trajectory files. A file header is followed by chunks,
+ *        each chunk is a chunk header and a number of records. A record is
+ *        RECORD_HEADER + 2 * state_dim float32 values:
+ *        action, reward, end, state, next state.
+ */
+struct TrajectoryFormat {
+    static constexpr uint32_t VERSION = 1;            //<! Current format version
+    static constexpr uint32_t CHUNK_MAGIC = 0x4B4E4843; //<! "CHNK", start of a chunk
+    static constexpr int RECORD_HEADER = 3;           //<! Floats before the states
+
+    /**
+     * @brief Header at the start of the file
+     */
+    struct FileHeader {
+        char magic[8];      //<! File signature "RLAGTRAJ"
+        uint32_t version;   //<! Format version
+        uint32_t state_dim; //<! Size of the state vectors
+    };
+
+    /**
+     * @brief Header of a chunk, the index of the file
+     */
+    struct ChunkHeader {
+        uint32_t magic;   //<! CHUNK_MAGIC
+        uint32_t records; //<! Number of records in the chunk
+    };
+
+    /**
+     * @brief Get the number of floats of a record
+     *
+     * @param state_dim Size of the state vectors
+     * @return int
+     */
+    static int record_size(int state_dim) { return RECORD_HEADER + 2 * state_dim; }
+};
+
+/**
+ * @brief Appends transitions to a trajectory file. Records are collected in
+ *        a chunk buffer and written with one call when the chunk is full, so
+ *        a crash loses at most the last chunk. Existing files are continued.
+ *        Not thread safe, use one writer per thread.
+ */
+class TrajectoryWriter {
+  public:
+    /**
+     * @brief Opens a trajectory file for appending
+     *
+     * @param filename Trajectory file, created if it does not exist
+     * @param state_dim Size of the state vectors
+     * @param chunk_records Number of records per chunk
+     */
+    TrajectoryWriter(const std::string& filename, int state_dim, int chunk_records = 4096);
+
+    /**
+     * @brief Writes the buffered records
+     *
+     */
+    ~TrajectoryWriter();
+
+    /**
+     * @brief Appends one transition
+     *
+     * @param state State vector with state_dim values
+     * @param action Action taken in the state
+     * @param reward Reward of the transition
+     * @param next_state Next state vector with state_dim values
+     * @param end How the transition ends the episode
+     */
+    void record(const double* state, int action, double reward,
+        const double* next_state, TrajectoryEnd end) {
+        float* out = chunk.data() + std::size_t(buffered) * record_size;
+        out[0] = float(action);
+        out[1] = float(reward);
+        out[2] = float(int(end));
+        for (int d=0; d < state_dim; d++) {
+            out[TrajectoryFormat::RECORD_HEADER + d] = float(state[d]);
+            out[TrajectoryFormat::RECORD_HEADER + state_dim + d] = float(next_state[d]);
+        }
+        if (++buffered == chunk_records) flush();
+    }
+
+    /**
+     * @brief Writes the buffered records as a chunk
+     *
+     */
+    void flush();
+
+    /**
+     * @brief Get the number of records written by this writer, including
+     *        the buffered ones
+     *
+     * @return uint64_t
+     */
+    uint64_t getRecords() const { return written + buffered; }
+
+  private:
+    std::string filename;     //<! Trajectory file
+    int state_dim;            //<! Size of the state vectors
+    int record_size;          //<! Floats per record
+    int chunk_records;        //<! Records per chunk
+    int buffered;             //<! Records in the chunk buffer
+    uint64_t written;         //<! Records written to the file
+    std::vector<float> chunk; //<! Chunk buffer
+    std::ofstream outfile;    //<! Output file
+};
+
+/**
+ * @brief Records the transitions of all learner threads, each thread
+ *        appends to its own file prefix + "_<thread>.traj". Writers are
+ *        opened on the first record of their thread.
+ */
+class TrajectoryRecorder {
+  public:
+    /**
+     * @brief Construct a new trajectory recorder
+     *
+     * @param prefix Path and name prefix of the files
+     * @param state_dim Size of the state vectors
+     * @param chunk_records Number of records per chunk
+     */
+    TrajectoryRecorder(const std::string& prefix, int state_dim, int chunk_records = 4096);
+
+    /**
+     * @brief Appends one transition to the file of the calling thread
+     *
+     * @param state State vector with state_dim values
+     * @param action Action taken in the state
+     * @param reward Reward of the transition
+     * @param next_state Next state vector with state_dim values
+     * @param end How the transition ends the episode
+     */
+    void record(const double* state, int action, double reward,
+        const double* next_state, TrajectoryEnd end) {
+        writer().record(state, action, reward, next_state, end);
+    }
+
+    /**
+     * @brief Writes the buffered records of all threads. No thread may
+     *        record during the call.
+     *
+     */
+    void flush();
+
+    /**
+     * @brief Get the files which have been written
+     *
+     * @return std::vector<std::string>
+     */
+    std::vector<std::string> getFiles() const;
+
+    /**
+     * @brief Get the number of records of all threads
+     *
+     * @return uint64_t
+     */
+    uint64_t getRecords() const;
+
+  private:
+    std::string prefix;   //<! Path and name prefix of the files
+    int state_dim;        //<! Size of the state vectors
+    int chunk_records;    //<! Records per chunk
+    std::vector<std::unique_ptr<TrajectoryWriter>> writers; //<! Writer of each thread
+
+    /**
+     * @brief Get the writer of the calling thread
+     *
+     * @return TrajectoryWriter&
+     */
+    TrajectoryWriter& writer();
+
+    /**
+     * @brief Get the file of a thread
+     *
+     * @param thread Thread number
+     * @return std::string
+     */
+    std::string filename(int thread) const;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "src/learner/fitted_q.h"
+#include <iostream>
+#include <omp.h>
+#include <stdexcept>
+#include <utility>
+
+FittedQ::FittedQ(double discount, std::shared_ptr<Approximator> approximator)
+    : discount(discount), approximator(std::move(approximator)), verbose(false) {}
+
+void FittedQ::add_file(const std::string& filename) {
+    std::unique_ptr<TrajectoryReader> reader(new TrajectoryReader(filename));
+    if (reader->getStateDim() != approximator->dimensions_of_statespace)
+        throw std::invalid_argument("Trajectory has another state size: " + filename);
+    for (std::size_t chunk = 0; chunk < reader->chunks(); chunk++) {
+        chunks.push_back({reader.get(), chunk, size()});
+        targets.resize(targets.size() + reader->chunk_records(chunk));
+    }
+    readers.push_back(std::move(reader));
+}
+
+uint64_t FittedQ::size() const {
+    return targets.size();
+}
+
+void FittedQ::learn(int epochs, std::vector<double>& msve_per_epoch_out) {
+    msve_per_epoch_out.resize(epochs);
+    WeightTable* weights = approximator->weight_table();
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        compute_targets();
+        double ssve = fit_targets();
+        if (weights) weights->sync_replicas();
+        msve_per_epoch_out[epoch] = size() > 0 ? ssve / size() : 0.0;
+        if (verbose) {
+            std::cout << "epoch: " << epoch + 1 << ", msve: "
+                      << msve_per_epoch_out[epoch] << std::endl;
+        }
+    }
+}
+
+void FittedQ::compute_targets() {
+    // Nothing writes the weights, readers need no locks
+    const ConcurrencyMode concurrency_mode = approximator->concurrency_mode;
+    if (concurrency_mode == ConcurrencyMode::LOCKED)
+        approximator->concurrency_mode = ConcurrencyMode::HOGWILD;
+    #pragma omp parallel
+    {
+        // Buffers of this thread, filled without allocations
+        Eigen::VectorXd next_state(approximator->dimensions_of_statespace);
+        Eigen::VectorXd values(approximator->number_of_actions);
+        #pragma omp for schedule(dynamic, 1)
+        for (std::size_t c = 0; c < chunks.size(); c++) {
+            const Chunk& chunk = chunks[c];
+            const uint64_t records = chunk.reader->chunk_records(chunk.chunk);
+            for (uint64_t i = 0; i < records; i++) {
+                TrajectoryRecord record = chunk.reader->chunk_record(chunk.chunk, i);
+                double target = record.reward();
+                // Truncated episodes continue in the next state
+                if (record.end() != TrajectoryEnd::TERMINAL) {
+                    next_state = record.next_state().cast<double>();
+                    approximator->predict_all(next_state, values);
+                    target += discount * values.maxCoeff();
+                }
+                targets[chunk.first_target + i] = float(target);
+            }
+        }
+    }
+    approximator->concurrency_mode = concurrency_mode;
+}
+
+double FittedQ::fit_targets() {
+    double ssve = 0.0;
+    #pragma omp parallel reduction(+:ssve)
+    {
+        Eigen::VectorXd state(approximator->dimensions_of_statespace);
+        #pragma omp for schedule(dynamic, 1)
+        for (std::size_t c = 0; c < chunks.size(); c++) {
+            const Chunk& chunk = chunks[c];
+            const uint64_t records = chunk.reader->chunk_records(chunk.chunk);
+            for (uint64_t i = 0; i < records; i++) {
+                TrajectoryRecord record = chunk.reader->chunk_record(chunk.chunk, i);
+                state = record.state().cast<double>();
+                double td_error = approximator->update(
+                    state, record.action(), targets[chunk.first_target + i]);
+                ssve += td_error * td_error;
+            }
+            // Publish buffered updates of this chunk
+            if (approximator->concurrency_mode == ConcurrencyMode::BUFFERED)
+                approximator->merge_deltas();
+        }
+    }
+    return ssve;
+}
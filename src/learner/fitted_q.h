@@ -0,0 +1,83 @@
+#ifndef __FITTED_Q_H_
+#define __FITTED_Q_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "src/approximator/approximator.h"
+#include "src/experience/trajectory_reader.h"
+
+/**
+ * @brief Offline fitted Q iteration over recorded trajectory files, no
+ *        environment is involved. Every epoch first computes the targets
+ *        r + discount * max_a Q(s', a) of all records with the weights of
+ *        the previous epoch (final states have no future value), then
+ *        regresses the approximator towards them with one sweep of updates.
+ *        Both passes distribute the chunks of the mapped files over all
+ *        threads, updates follow the concurrency mode of the approximator.
+ */
+class FittedQ {
+  public:
+    const double discount;                          //<! Discount factor
+    const std::shared_ptr<Approximator> approximator; //<! Value function approximator
+    bool verbose;                                   //<! Enable or disable console messages
+
+    /**
+     * @brief Construct a new fitted Q learner
+     *
+     * @param discount The discount factor gamma
+     * @param approximator The approximator that estimates the value function
+     */
+    FittedQ(double discount, std::shared_ptr<Approximator> approximator);
+
+    /**
+     * @brief Maps a trajectory file and adds its records to the data set
+     *
+     * @param filename Trajectory file with the state size of the approximator
+     */
+    void add_file(const std::string& filename);
+
+    /**
+     * @brief Get the number of records of all files
+     *
+     * @return uint64_t
+     */
+    uint64_t size() const;
+
+    /**
+     * @brief Learning procedure
+     *
+     * @param epochs Number of sweeps over the data set
+     * @param msve_per_epoch_out Output of the mean square value error of each epoch
+     */
+    void learn(int epochs, std::vector<double>& msve_per_epoch_out);
+
+  private:
+    /**
+     * @brief Chunk of a file, the unit of work of a thread
+     */
+    struct Chunk {
+        const TrajectoryReader* reader; //<! File of the chunk
+        std::size_t chunk;              //<! Chunk number within the file
+        uint64_t first_target;          //<! Position of the chunk's targets
+    };
+
+    std::vector<std::unique_ptr<TrajectoryReader>> readers; //<! Mapped files
+    std::vector<Chunk> chunks;                              //<! Chunks of all files
+    std::vector<float> targets;                             //<! Target of each record in the current epoch
+
+    /**
+     * @brief Computes the targets of all records with the current weights
+     *
+     */
+    void compute_targets();
+
+    /**
+     * @brief Updates the approximator towards the targets
+     *
+     * @return Sum of square value errors
+     */
+    double fit_targets();
+};
+
+#endif
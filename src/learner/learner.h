@@ -2,6 +2,7 @@
 #define __LEARNER_H_
 
 #include <omp.h>
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -9,10 +10,13 @@
 #include <memory>
 #include <iostream>
 #include <functional>
+#include <random>
 #include <time.h>
 #include "src/approximator/approximator.h"
 #include "src/policy/policy.h"
+#include "src/environment/counter_rng.h"
 #include "src/environment/environment.h"
+#include "src/experience/trajectory_writer.h"
 
 /**
  * @brief Base class for learning algorithms. Restricted to discrete
@@ -20,13 +24,25 @@
  */
 class Learner {
   public:
-      typedef std::function<double(Eigen::VectorXd, int, Eigen::VectorXd, Environment*)> reward_function; //!> Reward function, (state, action, state_next, env) -> reward
+      typedef std::function<double(const Eigen::Ref<const Eigen::VectorXd>&, int,
+        const Eigen::Ref<const Eigen::VectorXd>&, Environment*)> reward_function; //!> Reward function, (state, action, state_next, env) -> reward, states are passed without copies
       typedef std::function<std::shared_ptr<Environment>(void)> environment_function;                     //!> Environment function, provides learning environment instance
 
       bool verbose;                                     //<! Enable or disable console messages
+      /**
+       * Episodes between syncs of NUMA weight replicas, 0 for one episode per
+       * OpenMP thread. Reads through the replicas (action selection and the
+       * bootstrap values) see the weights as of the last sync: at most
+       * replica_sync_interval episodes old and without the updates of the
+       * running episode itself.
+       */
+      int replica_sync_interval;
+      uint64_t run_seed;                                //<! Seed of the environments and the exploration, episode i uses stream i
+      uint64_t episodes_learned;                        //<! Number of episodes of previous learn calls
       const std::shared_ptr<Approximator> approximator; //<! Value function approximator
       reward_function reward;                           //<! Reward function
       environment_function environment_generator;       //<! Environment generator function
+      std::shared_ptr<TrajectoryRecorder> recorder;     //<! Records the transitions if set
   
       /**
        * @brief Construct a new Learner object
@@ -39,7 +55,9 @@ class Learner {
         std::shared_ptr<Approximator> approximator,
         reward_function reward,
         environment_function environment_generator)
-        : verbose(false), approximator(std::move(approximator)),
+        : verbose(false), replica_sync_interval(0),
+          run_seed(std::random_device()()), episodes_learned(0),
+          approximator(std::move(approximator)),
           reward(std::move(reward)), environment_generator(
             std::move(environment_generator)) {}
 
@@ -68,36 +86,59 @@ class Learner {
         msve_per_episode_out.resize(episodes);
         total_reward_per_episode_out.resize(episodes);
         time_t last_msg = time(0) - 5;
-        #pragma omp parallel for ordered schedule(dynamic, 1)
-        for (int episode = 0; episode < episodes; episode++) {
-          double ssve_buffer = 0;
-          double total_reward_buffer = 0.0;
-          auto environment = environment_generator();
-          environment->reset();
-          learn_episode(
-            max_steps_per_episode,
-            &ssve_buffer,
-            &total_reward_buffer,
-            environment.get());
-          #pragma omp ordered
-          {
-            double msve = ssve_buffer / max_steps_per_episode;
-            msve_per_episode_out[episode] = msve;
-            total_reward_per_episode_out[episode] = total_reward_buffer;
-            if (verbose && time(0) - last_msg > 5) {
-              last_msg += 5;
-              std::cout << ".--------------------------------------." << std::endl
-                        << "| Ep: " << episode                        << std::endl 
-                        << "| SVE mean: " << msve                     << std::endl 
-                        << "| Reward total: " << total_reward_buffer  << std::endl
-                        << "'......................................'" << std::endl
-                        << std::endl << std::flush;
+        WeightTable* weights = approximator->weight_table();
+        // Replicas are synced between parallel loops, when no learner writes
+        // and all threads copy a part of the table
+        const int sync_interval = !weights || !weights->isReplicated() ?
+          std::max(1, episodes) : replica_sync_interval > 0 ?
+          replica_sync_interval : omp_get_max_threads();
+        for (int first = 0; first < episodes; first += sync_interval) {
+          const int last = std::min(episodes, first + sync_interval);
+          #pragma omp parallel for ordered schedule(dynamic, 1)
+          for (int episode = first; episode < last; episode++) {
+            double ssve_buffer = 0;
+            double total_reward_buffer = 0.0;
+            auto environment = environment_generator();
+            // Episodes are reproducible, whichever thread runs them
+            environment->seed(run_seed, episodes_learned + episode);
+            environment->reset();
+            CounterRng exploration(run_seed, EXPLORATION_STREAMS + episodes_learned + episode);
+            learn_episode(
+              max_steps_per_episode,
+              &ssve_buffer,
+              &total_reward_buffer,
+              environment.get(),
+              exploration,
+              episodes_learned + episode);
+            // Publish buffered updates of this episode
+            if (approximator->concurrency_mode == ConcurrencyMode::BUFFERED)
+              approximator->merge_deltas();
+            #pragma omp ordered
+            {
+              double msve = ssve_buffer / max_steps_per_episode;
+              msve_per_episode_out[episode] = msve;
+              total_reward_per_episode_out[episode] = total_reward_buffer;
+              if (verbose && time(0) - last_msg > 5) {
+                last_msg += 5;
+                std::cout << ".--------------------------------------." << std::endl
+                          << "| Ep: " << episode                        << std::endl 
+                          << "| SVE mean: " << msve                     << std::endl 
+                          << "| Reward total: " << total_reward_buffer  << std::endl
+                          << "'......................................'" << std::endl
+                          << std::endl << std::flush;
+              }
             }
           }
+          if (weights) weights->sync_replicas();
         }
+        if (recorder) recorder->flush();
+        episodes_learned += episodes;
     }
 
  protected:
+   static constexpr uint64_t EXPLORATION_STREAMS = uint64_t(1) << 63; //<! Episode i explores with stream EXPLORATION_STREAMS + i of the run seed
+   static constexpr uint64_t REPLAY_STREAMS = uint64_t(1) << 62;      //<! Episode i samples replayed transitions with stream REPLAY_STREAMS + i of the run seed
+
    /**
     * @brief Implements one learning procedure for one episode
     * 
@@ -105,12 +146,17 @@ class Learner {
     * @param ssve_out Output of sum of square value errors
     * @param total_reward_out Output of total reward
     * @param environment Pointer to the environment to learn in
+    * @param random Random number generator of the policy in this episode
+    * @param episode Number of the episode in the run, selects further
+    *        random streams of the episode
     */
    virtual void learn_episode(
       int max_steps,
       double* ssve_out,
       double* total_reward_out,
-      Environment* environment) = 0;
+      Environment* environment,
+      CounterRng& random,
+      uint64_t episode) = 0;
 };
 
 #endif 
\ No newline at end of file
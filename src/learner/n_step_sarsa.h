@@ -0,0 +1,154 @@
+#ifndef __N_STEP_SARSA_H_
+#define __N_STEP_SARSA_H_
+
+#include <algorithm>
+#include "src/experience/trajectory_writer.h"
+
+/**
+ * @brief Step loop of one n-step SARSA episode, shared by Sarsa (runtime
+ *        components) and StaticSarsa (components composed at compile time).
+ *
+ *        Rewards are grouped in blocks of n steps. The return of a window
+ *        is the rest of one block, stored as suffix returns when the block
+ *        is complete, plus the beginning of the next block, accumulated
+ *        in head_return. So each step costs O(1) instead of a sum over the
+ *        window.
+ *
+ *        Steps provides the components and the ring buffers of the calling
+ *        thread:
+ *        - n_steps(), discount_power(k) for k = 0..n_steps
+ *        - state, next_state and the ring buffers rewards, actions and
+ *          suffix_returns with n_steps entries each
+ *        - store_state(slot, state) into the ring buffer of states
+ *        - reset(state), step(action, next_state, terminal) of the environment
+ *        - reward(state, action, next_state)
+ *        - select(state) of the policy
+ *        - observe(state, action, reward, next_state, terminal) after each step
+ *        - future_value(slot, action), the value of a stored state
+ *        - update(slot, action, target) of a stored state, returns the error
+ *        The calls are resolved at compile time and can be inlined.
+ *
+ * @param steps Components and buffers of the episode
+ * @param max_steps Maximum number of steps
+ * @param ssve Sum of the squared value errors of the episode (output)
+ * @param total_reward Sum of the rewards of the episode (output)
+ * @param recorder Records the transitions if not null
+ */
+template <class Steps>
+void n_step_sarsa_episode(
+        Steps& steps,
+        int max_steps,
+        double* ssve,
+        double* total_reward,
+        TrajectoryRecorder* recorder) {
+    const int n_steps = steps.n_steps();
+    const double discount = steps.discount_power(1);
+    // Stores the discounted sums from each reward of a block up to the
+    // block's last reward
+    auto store_suffix_returns = [&](int first, int last) {
+        double suffix_return = 0.0;
+        for (int i=last; i >= first; i--) {
+            suffix_return = steps.rewards[i % n_steps] + discount * suffix_return;
+            steps.suffix_returns[i % n_steps] = suffix_return;
+        }
+    };
+
+    // Reset environment and get initial state / action
+    auto& state = steps.state;
+    auto& next_state = steps.next_state;
+    state.setZero();
+    steps.reset(state);
+    int action = steps.select(state);
+    int step = 0;
+    int tau = 0;
+    *ssve = 0;
+    *total_reward = 0;
+    double head_return = 0.0;
+    // Keep track of remaining steps
+    int remaining_steps = max_steps;
+    // Store initial state and action
+    steps.store_state(0, state);
+    steps.actions[0] = action;
+    // Outer loop: Based on remaining steps
+    while (remaining_steps > 0) {
+        // Inner loop: Based on finite horizont
+        do {
+            if (step < max_steps) {
+                // Perform action in environment
+                bool terminal = false;
+                next_state.setZero();
+                steps.step(action, next_state, terminal);
+                double reward_value = steps.reward(state, action, next_state);
+                *total_reward = *total_reward + reward_value;
+                if (recorder) {
+                    recorder->record(state.data(), action, reward_value, next_state.data(),
+                        terminal ? TrajectoryEnd::TERMINAL : step + 1 == max_steps ?
+                        TrajectoryEnd::TRUNCATED : TrajectoryEnd::NONE);
+                }
+                steps.observe(state, action, reward_value, next_state, terminal);
+                // Finish the previous block before its first reward is overwritten
+                const int block_position = step % n_steps;
+                if (block_position == 0) {
+                    if (step > 0) store_suffix_returns(step + 1 - n_steps, step);
+                    head_return = reward_value;
+                } else {
+                    head_return += steps.discount_power(block_position) * reward_value;
+                }
+                // Store next reward and next state
+                steps.rewards[(step+1) % n_steps] = reward_value;
+                steps.store_state((step+1) % n_steps, next_state);
+                // Prepare next iteration
+                state = next_state;
+                action = steps.select(state);
+                if (terminal) {
+                    steps.reset(state);
+                    action = steps.select(state);
+                    max_steps = step + 1;
+                } else {
+                    // Store next action
+                    steps.actions[(step+1) % n_steps] = action;
+                }
+                // No more rewards follow, the last block ends early
+                if (step + 1 == max_steps)
+                    store_suffix_returns(step + 1 - block_position, step + 1);
+            }
+
+            // Tau is time index we want to update
+            tau = step - n_steps + 1;
+            if (tau >= 0) {
+                // accumulate discounted one step rewards
+                const int block_position = tau % n_steps;
+                double reward_sum = head_return;
+                if (block_position != 0) {
+                    reward_sum = steps.suffix_returns[(tau+1) % n_steps];
+                    // Rewards of the next block, if there are any
+                    if (std::min(max_steps, step + 1) > tau + n_steps - block_position)
+                        reward_sum += steps.discount_power(n_steps - block_position) * head_return;
+                }
+                // add expected future reward
+                int future_time = tau + n_steps;
+                if (future_time < max_steps) {
+                    reward_sum = reward_sum + steps.discount_power(n_steps)
+                        * steps.future_value(future_time % n_steps,
+                            steps.actions[future_time % n_steps]);
+                }
+                // perform update
+                double td_error = steps.update(tau % n_steps,
+                    steps.actions[tau % n_steps], reward_sum);
+                *ssve = *ssve + td_error * td_error;
+            }
+
+            // Increase step
+            step = step + 1;
+        } while (tau != max_steps - 1);
+
+        // Decrease remaining steps
+        remaining_steps -= max_steps;
+
+        // Adapt maximum steps for inner loop also
+        max_steps = remaining_steps;
+        step = 0;
+    }
+}
+
+#endif
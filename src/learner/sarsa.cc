@@ -1,7 +1,9 @@
 #include "src/learner/sarsa.h"
+#include "src/learner/n_step_sarsa.h"
 #include <deque>
 #include <utility>
 #include <algorithm>
+#include <cmath>
 #include <vector>
 
 Sarsa::Sarsa(
@@ -12,105 +14,128 @@ Sarsa::Sarsa(
         environment_function const& environment_generator,
         int n_steps) :
     Learner(approximator, reward, environment_generator),
-    discount(discount), policy(policy), n_steps(n_steps) {
+    discount(discount), policy(policy), n_steps(n_steps),
+    replay_interval(4), replay_batch_size(32),
+    discount_powers(n_steps + 1),
+    workspaces(omp_get_max_threads()) {
+    for (int k=0; k <= n_steps; k++) discount_powers[k] = std::pow(discount, k);
 }
 
 std::shared_ptr<Policy> Sarsa::get_policy() {
     return policy;
 }
 
+void Sarsa::prepare(Workspace& workspace, Environment* environment) const {
+    const int state_dim = environment->getStateDim();
+    const int stage_size = std::max(1, replay_interval);
+    if (replay && (workspace.replay_stage.capacity() != stage_size
+        || workspace.replay_stage.states.rows() != state_dim))
+        workspace.replay_stage.reserve(stage_size, state_dim);
+    if (workspace.states.rows() == state_dim
+        && workspace.future_values.size() == approximator->number_of_actions)
+        return;
+    workspace.states = Eigen::MatrixXd::Zero(state_dim, n_steps);
+    workspace.rewards.assign(n_steps, 0.0);
+    workspace.actions.assign(n_steps, 0);
+    workspace.suffix_returns.assign(n_steps, 0.0);
+    workspace.future_values = Eigen::VectorXd::Zero(approximator->number_of_actions);
+    workspace.state = Eigen::VectorXd::Zero(state_dim);
+    workspace.next_state = Eigen::VectorXd::Zero(state_dim);
+}
+
+void Sarsa::replay_minibatch(Workspace& workspace) {
+    ReplayBatch& batch = workspace.replay_batch;
+    if (batch.capacity() != replay_batch_size) {
+        batch.reserve(replay_batch_size, int(workspace.state.size()));
+        workspace.replay_errors.assign(replay_batch_size, 0.0);
+    }
+    replay->add(workspace.replay_stage);
+    const int count = replay->sample(replay_batch_size, workspace.random, batch);
+    for (int i=0; i < count; i++) {
+        double target = batch.rewards[i];
+        if (!batch.terminals[i]) {
+            approximator->predict_all(batch.next_states.col(i), workspace.future_values);
+            target += discount * workspace.future_values.maxCoeff();
+        }
+        // Importance sampling weight scales the step towards the target
+        workspace.replay_errors[i] = approximator->update(
+            batch.states.col(i), batch.actions[i], target, batch.weights[i]);
+    }
+    replay->update_priorities(batch, workspace.replay_errors.data());
+}
+
+struct Sarsa::Steps {
+    Sarsa& sarsa;
+    Workspace& workspace;
+    Environment* environment;
+    CounterRng& random;
+    Eigen::VectorXd& state;
+    Eigen::VectorXd& next_state;
+    std::vector<double>& rewards;
+    std::vector<int>& actions;
+    std::vector<double>& suffix_returns;
+
+    Steps(Sarsa& sarsa, Workspace& workspace, Environment* environment,
+            CounterRng& random)
+        : sarsa(sarsa), workspace(workspace), environment(environment),
+          random(random),
+          state(workspace.state), next_state(workspace.next_state),
+          rewards(workspace.rewards), actions(workspace.actions),
+          suffix_returns(workspace.suffix_returns) {}
+
+    int n_steps() const { return sarsa.n_steps; }
+
+    double discount_power(int k) const { return sarsa.discount_powers[k]; }
+
+    void store_state(int slot, const Eigen::VectorXd& value) {
+        workspace.states.col(slot) = value;
+    }
+
+    void reset(Eigen::VectorXd& observation) { environment->reset(observation); }
+
+    void step(int action, Eigen::VectorXd& observation, bool& terminal) {
+        environment->step(action, observation, terminal);
+    }
+
+    double reward(const Eigen::VectorXd& from, int action, const Eigen::VectorXd& to) {
+        return sarsa.reward(from, action, to, environment);
+    }
+
+    int select(const Eigen::VectorXd& observation) { return sarsa.policy->apply(observation, random); }
+
+    void observe(const Eigen::VectorXd& from, int action, double reward_value,
+            const Eigen::VectorXd& to, bool terminal) {
+        if (!sarsa.replay) return;
+        // The buffer is locked once per minibatch, not in every step
+        workspace.replay_stage.push(from.data(), action, reward_value, to.data(), terminal);
+        if (workspace.replay_stage.full()) sarsa.replay_minibatch(workspace);
+    }
+
+    double future_value(int slot, int action) {
+        sarsa.approximator->predict_all(workspace.states.col(slot), workspace.future_values);
+        return workspace.future_values[action];
+    }
+
+    double update(int slot, int action, double target) {
+        return sarsa.approximator->update(workspace.states.col(slot), action, target);
+    }
+};
+
 void Sarsa::learn_episode(
         int max_steps,
         double* ssve,
         double* total_reward,
-        Environment* environment) {
-    // Storing previous states
-    Eigen::MatrixXd n_step_states = Eigen::MatrixXd::Zero(
-        environment->getStateDim(), n_steps);
-    // Storing previous rewards
-    std::vector<double> n_step_rewards(n_steps);
-    // Storing previous actions
-    std::vector<int> n_step_actions(n_steps);
-    // Reset environment and get initial state / action
-    Eigen::VectorXd state = Eigen::VectorXd::Zero(environment->getStateDim());
-    environment->reset(state);
-    int action = policy->apply(state);
-    int step = 0;
-    int tau = 0;
-    *ssve = 0;
-    *total_reward = 0;
-    // Keep track of remaining steps
-    int remaining_steps = max_steps;
-    // Store initial state and action
-    n_step_states.col(step % n_steps) = state;
-    n_step_actions[step % n_steps] = action;
-    // Outer loop: Based on remaining steps
-    while(remaining_steps > 0) {
-        // Inner loop: Based on finite horizont
-        do {
-            if (step < max_steps) {
-                // Perform action in environment
-                bool terminal = false;
-                Eigen::VectorXd next_state = Eigen::VectorXd::Zero(state.size());
-                environment->step(action, next_state, terminal);
-                double reward_value = reward(state, action, next_state, environment);
-                *total_reward = *total_reward + reward_value;
-                // Store next reward and next state
-                n_step_rewards[(step+1) % n_steps] = reward_value;
-                n_step_states.col((step+1) % n_steps) = next_state;
-                // Prepare next iteration
-                state = next_state;
-                action = policy->apply(state);
-                if (terminal) {
-                    environment->reset(state);
-                    action = policy->apply(state);
-                    max_steps = step + 1;
-                }
-                else {
-                    // Store next action
-                    n_step_actions[(step+1) % n_steps] = action;
-                }
-            }
-
-            // Tau is time index we want to update
-            tau = step - n_steps + 1;
-            if (tau >= 0) {
-                double reward_sum = 0.0;
-                // accumulate discounted one step rewards
-                for (int i=tau+1; i <= std::min(max_steps, step + 1); i++) {
-                    double future_reward = n_step_rewards[i % n_steps];
-                    double dampening = std::pow(discount, i-tau-1);
-                    reward_sum = reward_sum + dampening*future_reward;
-                }
-                // add expected future reward
-                int future_time = tau + n_steps;
-                if (future_time < max_steps) {
-                    auto future_action = Eigen::Map<Eigen::Matrix<int, 1, 1>>(
-                        &n_step_actions[future_time % n_steps]);
-                    auto future_state = n_step_states.col(future_time % n_steps);
-                    reward_sum = reward_sum 
-                        + std::pow(discount, n_steps)*approximator->predict(
-                            future_state, future_action)[0];
-                }
-                // perform update
-                double td_error = approximator->update(
-                    n_step_states.col(tau % n_steps),
-                    n_step_actions[tau % n_steps],
-                    reward_sum);
-                *ssve = *ssve + std::pow(td_error, 2.0);
-            }
-
-            // Increase step
-            step = step + 1;
-
-        } while(tau != max_steps - 1);
-
-        // Decrease remaining steps
-        remaining_steps -= max_steps;
-
-        // Adapt maximum steps for inner loop also
-        max_steps = remaining_steps;
-        step = 0;
-    }
-    
+        Environment* environment,
+        CounterRng& random,
+        uint64_t episode) {
+    // Buffers of this thread (or of this call outside a parallel region)
+    Workspace local_workspace;
+    const int thread = omp_get_thread_num();
+    Workspace& workspace = thread < int(workspaces.size()) ?
+        workspaces[thread] : local_workspace;
+    prepare(workspace, environment);
+    // Samples depend on the episode, not on the thread which runs it
+    workspace.random.seed(run_seed, REPLAY_STREAMS + episode);
+    Steps steps(*this, workspace, environment, random);
+    n_step_sarsa_episode(steps, max_steps, ssve, total_reward, recorder.get());
 }
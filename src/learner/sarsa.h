@@ -2,6 +2,8 @@
 #define __SARSA_H_
 
 #include <memory>
+#include <vector>
+#include "src/experience/replay_buffer.h"
 #include "src/learner/learner.h"
 #include "src/policy/policy.h"
 
@@ -14,6 +16,9 @@ class Sarsa : public Learner {
     const double discount;                //<! Discount factor
     const std::shared_ptr<Policy> policy; //<! Policy to learn
     const int n_steps;                    //<! N-Steps parameter of n-step SARSA
+    std::shared_ptr<ReplayBuffer> replay; //<! Replays stored transitions between the online updates if set
+    int replay_interval;                  //<! Steps between two replayed minibatches, the transitions are added to the buffer as a group
+    int replay_batch_size;                //<! Transitions of a replayed minibatch
 
    /**
    * Constructor for the Sarsa algorithm class
@@ -36,12 +41,60 @@ class Sarsa : public Learner {
     
     std::shared_ptr<Policy> get_policy() override;
 
+  private:
+    /**
+     * @brief Buffers of one worker thread, allocated once and reused by all
+     *        its episodes, so the step loop does not allocate.
+     */
+    struct Workspace {
+        Eigen::MatrixXd states;             //<! Previous states (ring buffer)
+        std::vector<double> rewards;        //<! Previous rewards (ring buffer)
+        std::vector<int> actions;           //<! Previous actions (ring buffer)
+        std::vector<double> suffix_returns; //<! Discounted rewards up to the end of their block (ring buffer)
+        Eigen::VectorXd future_values;      //<! Values of all actions in the bootstrap state
+        Eigen::VectorXd state;              //<! Current state
+        Eigen::VectorXd next_state;         //<! State after the current step
+        ReplayStage replay_stage;           //<! Transitions since the last replayed minibatch
+        ReplayBatch replay_batch;           //<! Replayed transitions
+        std::vector<double> replay_errors;  //<! Value errors of the replayed transitions
+        CounterRng random;                  //<! Sampling of the replayed transitions, seeded per episode
+    };
+
+    std::vector<double> discount_powers; //<! Discount to the power of 0 to n_steps
+    std::vector<Workspace> workspaces;   //<! One workspace per OpenMP thread
+
+    /**
+     * @brief Sizes the buffers of a workspace for an environment.
+     *
+     * @param workspace Workspace of the calling thread
+     * @param environment Environment to learn in
+     */
+    void prepare(Workspace& workspace, Environment* environment) const;
+
+    /**
+     * @brief Components and workspace of one episode for the shared step
+     *        loop n_step_sarsa_episode.
+     */
+    struct Steps;
+
+    /**
+     * @brief Adds the staged transitions to the buffer and updates the
+     *        approximator with a prioritized minibatch of stored
+     *        transitions. Targets bootstrap with the greedy value of
+     *        the next state, since the transitions come from older policies.
+     *
+     * @param workspace Workspace of the calling thread
+     */
+    void replay_minibatch(Workspace& workspace);
+
   protected:
     void learn_episode(
         int max_steps,
         double* ssve_out,
         double* total_reward_out,
-        Environment* environment) override;
+        Environment* environment,
+        CounterRng& random,
+        uint64_t episode) override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,184 @@
+#ifndef __SPARSE_TRACE_H_
+#define __SPARSE_TRACE_H_
+
+#include "Eigen/Dense"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Sparse eligibility trace over weight indices. The entries are stored
+ *        densely (for the weight update), an open-addressing hash table finds
+ *        the entry of a weight index. The memory is reused between episodes.
+ */
+class SparseTrace {
+  public:
+    /**
+     * @brief Removes all entries
+     *
+     */
+    void clear() {
+        indices.clear();
+        values.clear();
+        // The capacity stays, the table regrows without allocations
+        if (!slots.empty()) slots.assign(MIN_SLOTS, EMPTY);
+    }
+
+    /**
+     * @brief Get the number of entries
+     *
+     * @return int
+     */
+    int size() const { return int(indices.size()); }
+
+    /**
+     * @brief Weight index of each entry
+     *
+     * @return const Eigen::Index*
+     */
+    const Eigen::Index* index_data() const { return indices.data(); }
+
+    /**
+     * @brief Trace value of each entry
+     *
+     * @return const double*
+     */
+    const double* value_data() const { return values.data(); }
+
+    /**
+     * @brief Sums the trace values times the feature values.
+     *
+     * @param feature_indices Weight index of each feature
+     * @param feature_values Value of each feature
+     * @param count Number of features
+     * @return Dot product of trace and features
+     */
+    double dot(const Eigen::Index* feature_indices, const double* feature_values,
+      int count) const {
+        double sum = 0.0;
+        for (int i=0; i < count; i++) {
+            int entry = find(feature_indices[i]);
+            if (entry >= 0) sum += values[entry] * feature_values[i];
+        }
+        return sum;
+    }
+
+    /**
+     * @brief Multiplies all trace values with a factor
+     *
+     * @param factor Decay factor, e.g. discount times lambda
+     */
+    void scale(double factor) {
+        for (double& value : values) value *= factor;
+    }
+
+    /**
+     * @brief Adds scale times the feature values to the trace.
+     *
+     * @param feature_indices Weight index of each feature
+     * @param feature_values Value of each feature
+     * @param count Number of features
+     * @param scale Factor of all feature values
+     */
+    void add(const Eigen::Index* feature_indices, const double* feature_values,
+      int count, double scale) {
+        for (int i=0; i < count; i++) {
+            int entry = find(feature_indices[i]);
+            if (entry < 0) entry = insert(feature_indices[i]);
+            values[entry] += scale * feature_values[i];
+        }
+    }
+
+    /**
+     * @brief Drops the entries whose magnitude is below a threshold. The hash
+     *        table shrinks with the entries, so the rebuild costs O(kept
+     *        entries) instead of O(peak entries).
+     *
+     * @param threshold Smallest trace value which is kept
+     */
+    void prune(double threshold) {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < values.size(); i++) {
+            if (std::abs(values[i]) >= threshold) {
+                indices[kept] = indices[i];
+                values[kept++] = values[i];
+            }
+        }
+        if (kept == values.size()) return;
+        indices.resize(kept);
+        values.resize(kept);
+        // Load factor of at most one quarter leaves room to grow again
+        std::size_t size = MIN_SLOTS;
+        while (size < 4 * kept) size *= 2;
+        rehash(std::min(size, slots.size()));
+    }
+
+  private:
+    static constexpr int32_t EMPTY = -1;         //<! Marks an unused slot
+    static constexpr std::size_t MIN_SLOTS = 64; //<! Smallest hash table
+
+    std::vector<Eigen::Index> indices; //<! Weight index of each entry
+    std::vector<double> values;        //<! Trace value of each entry
+    std::vector<int32_t> slots;        //<! Hash table of entry positions, size is a power of two
+
+    /**
+     * @brief Get the first slot to probe for a weight index
+     *
+     * @param index Weight index
+     * @return std::size_t
+     */
+    std::size_t slot(Eigen::Index index) const {
+        // Fibonacci hashing spreads neighboring weights
+        return std::size_t((uint64_t(index) * 0x9E3779B97F4A7C15ull) >> 20) & (slots.size() - 1);
+    }
+
+    /**
+     * @brief Get the entry of a weight index
+     *
+     * @param index Weight index
+     * @return Entry position or -1 if the index has no entry
+     */
+    int find(Eigen::Index index) const {
+        if (slots.empty()) return -1;
+        for (std::size_t s = slot(index);; s = (s + 1) & (slots.size() - 1)) {
+            if (slots[s] == EMPTY) return -1;
+            if (indices[slots[s]] == index) return slots[s];
+        }
+    }
+
+    /**
+     * @brief Appends a zero entry for a weight index
+     *
+     * @param index Weight index without entry
+     * @return Entry position
+     */
+    int insert(Eigen::Index index) {
+        // Keep the load factor below one half
+        if (2 * (indices.size() + 1) > slots.size())
+            rehash(std::max(MIN_SLOTS, 2 * slots.size()));
+        int entry = int(indices.size());
+        indices.push_back(index);
+        values.push_back(0.0);
+        std::size_t s = slot(index);
+        while (slots[s] != EMPTY) s = (s + 1) & (slots.size() - 1);
+        slots[s] = entry;
+        return entry;
+    }
+
+    /**
+     * @brief Rebuilds the hash table from the entries
+     *
+     * @param size Number of slots, a power of two
+     */
+    void rehash(std::size_t size) {
+        slots.assign(size, EMPTY);
+        for (std::size_t entry = 0; entry < indices.size(); entry++) {
+            std::size_t s = slot(indices[entry]);
+            while (slots[s] != EMPTY) s = (s + 1) & (slots.size() - 1);
+            slots[s] = int32_t(entry);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef __STATIC_SARSA_H_
+#define __STATIC_SARSA_H_
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include "src/learner/learner.h"
+#include "src/learner/n_step_sarsa.h"
+#include "src/policy/policy.h"
+
+/**
+ * @brief n-step SARSA with environment, policy, approximator and reward
+ *        composed at compile time. The step loop calls the typed methods of
+ *        the (final) classes directly, so the compiler can inline the whole
+ *        step; there are neither virtual nor std::function calls and the
+ *        buffers have fixed sizes. Both learners run the step loop
+ *        n_step_sarsa_episode, so they learn alike with the same components.
+ *        Sarsa remains the runtime-configurable variant (e.g. with replay).
+ *
+ * @tparam Env Environment with SIZE_OF_STATESPACE, NUMBER_OF_ACTIONS, step and reset
+ * @tparam FixedPolicy Policy with select(const double*, CounterRng&), e.g. FixedEpsilonGreedy
+ * @tparam FixedApproximator Approximator with action_values and learn, e.g. FixedTileCoding
+ * @tparam Reward Functor (state, action, state_next, const Env&) -> reward
+ * @tparam NSteps N-Steps parameter of n-step SARSA
+ */
+template <class Env, class FixedPolicy, class FixedApproximator, class Reward, int NSteps>
+class StaticSarsa final : public Learner {
+    static_assert(NSteps > 0, "Number of steps must be positive.");
+
+  public:
+    static constexpr int StateDim = Env::SIZE_OF_STATESPACE; //<! Size of the state vector
+    typedef Eigen::Matrix<double, StateDim, 1> State;        //<! State vector
+
+    const double discount;                     //<! Discount factor
+    const std::shared_ptr<FixedPolicy> policy; //<! Policy to learn
+    Reward static_reward;                      //<! Reward functor, replaces the reward function of Learner
+
+   /**
+   * @brief Constructor for the statically composed SARSA algorithm
+   * @param discount The discount factor gamma
+   * @param policy The policy that is used in the algorithm
+   * @param approximator The approximator that estimates the value function
+   * @param reward The reward functor to be used
+   * @param environment_generator Function which generates environments of type Env
+   */
+    StaticSarsa(
+        double discount,
+        const std::shared_ptr<FixedPolicy>& policy,
+        const std::shared_ptr<FixedApproximator>& approximator,
+        const Reward& reward,
+        environment_function const& environment_generator)
+      : Learner(approximator, reward_function(), environment_generator),
+        discount(discount), policy(policy), static_reward(reward),
+        fixed_approximator(approximator.get()) {
+        for (int k=0; k <= NSteps; k++) discount_powers[k] = std::pow(discount, k);
+    }
+
+    std::shared_ptr<Policy> get_policy() override {
+        return policy;
+    }
+
+  private:
+    FixedApproximator* fixed_approximator;        //<! Typed view of the approximator
+    std::array<double, NSteps + 1> discount_powers; //<! Discount to the power of 0 to NSteps
+
+    /**
+     * @brief Typed components and fixed-size buffers of one episode for the
+     *        shared step loop n_step_sarsa_episode.
+     */
+    struct Steps {
+        StaticSarsa& sarsa;
+        Env& env;
+        CounterRng& random;
+        State state;
+        State next_state;
+        std::array<State, NSteps> states;          //<! Previous states (ring buffer)
+        std::array<double, NSteps> rewards;        //<! Previous rewards (ring buffer)
+        std::array<int, NSteps> actions;           //<! Previous actions (ring buffer)
+        std::array<double, NSteps> suffix_returns; //<! Discounted rewards up to the end of their block (ring buffer)
+        typename FixedApproximator::ActionValues future_values;
+
+        Steps(StaticSarsa& sarsa, Env& env, CounterRng& random)
+            : sarsa(sarsa), env(env), random(random) {}
+
+        static constexpr int n_steps() { return NSteps; }
+
+        double discount_power(int k) const { return sarsa.discount_powers[k]; }
+
+        void store_state(int slot, const State& value) { states[slot] = value; }
+
+        void reset(State& observation) { env.reset(observation); }
+
+        void step(int action, State& observation, bool& terminal) {
+            env.step(action, observation, terminal);
+        }
+
+        double reward(const State& from, int action, const State& to) {
+            return sarsa.static_reward(from, action, to, env);
+        }
+
+        int select(const State& observation) { return sarsa.policy->select(observation.data(), random); }
+
+        void observe(const State&, int, double, const State&, bool) {}
+
+        double future_value(int slot, int action) {
+            sarsa.fixed_approximator->action_values(states[slot].data(), future_values);
+            return future_values[action];
+        }
+
+        double update(int slot, int action, double target) {
+            return sarsa.fixed_approximator->learn(states[slot].data(), action, target);
+        }
+    };
+
+  protected:
+    void learn_episode(
+        int max_steps,
+        double* ssve,
+        double* total_reward,
+        Environment* environment,
+        CounterRng& random,
+        uint64_t episode) override {
+        // Checked once per episode, the steps use the concrete type
+        Env* typed_environment = dynamic_cast<Env*>(environment);
+        if (!typed_environment)
+            throw std::invalid_argument("Environment has the wrong type.");
+        Steps steps(*this, *typed_environment, random);
+        n_step_sarsa_episode(steps, max_steps, ssve, total_reward, recorder.get());
+    }
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "src/learner/true_online_sarsa.h"
+#include <vector>
+
+TrueOnlineSarsa::TrueOnlineSarsa(
+        double const& discount,
+        std::shared_ptr<Policy> const& policy,
+        std::shared_ptr<Approximator> const& approximator,
+        reward_function const& reward,
+        environment_function const& environment_generator,
+        double lambda,
+        double trace_threshold) :
+    Learner(approximator, reward, environment_generator),
+    discount(discount), policy(policy), lambda(lambda),
+    trace_threshold(trace_threshold) {
+    if (this->approximator->max_features() <= 0)
+        throw std::invalid_argument("Approximator does not provide sparse features.");
+}
+
+std::shared_ptr<Policy> TrueOnlineSarsa::get_policy() {
+    return policy;
+}
+
+void TrueOnlineSarsa::learn_episode(
+        int max_steps,
+        double* ssve,
+        double* total_reward,
+        Environment* environment,
+        CounterRng& random,
+        uint64_t episode) {
+    const int max_features = approximator->max_features();
+    const double step_size = approximator->feature_step_size();
+    const double decay = discount * lambda;
+    // Features of the current and the next state-action pair
+    std::vector<Eigen::Index> indices(max_features), next_indices(max_features);
+    std::vector<double> values(max_features), next_values(max_features);
+    // Trace of each thread is reused by its episodes
+    static thread_local SparseTrace trace;
+    trace.clear();
+
+    // Reset environment and get initial state / action
+    Eigen::VectorXd state = Eigen::VectorXd::Zero(environment->getStateDim());
+    Eigen::VectorXd next_state = Eigen::VectorXd::Zero(state.size());
+    environment->reset(state);
+    int action = policy->apply(state, random);
+    int count = approximator->features(state, action, indices.data(), values.data());
+    double old_value = 0.0;
+    *ssve = 0;
+    *total_reward = 0;
+
+    for (int step = 0; step < max_steps; step++) {
+        // Perform action in environment
+        bool terminal = false;
+        environment->step(action, next_state, terminal);
+        double reward_value = reward(state, action, next_state, environment);
+        *total_reward = *total_reward + reward_value;
+        if (recorder) {
+            recorder->record(state.data(), action, reward_value, next_state.data(),
+                terminal ? TrajectoryEnd::TERMINAL : step + 1 == max_steps ?
+                TrajectoryEnd::TRUNCATED : TrajectoryEnd::NONE);
+        }
+
+        // Terminal states have no future value
+        int next_action = 0;
+        int next_count = 0;
+        double next_value = 0.0;
+        if (!terminal) {
+            next_action = policy->apply(next_state, random);
+            next_count = approximator->features(
+                next_state, next_action, next_indices.data(), next_values.data());
+            next_value = approximator->feature_sum(
+                next_indices.data(), next_values.data(), next_count);
+        }
+        double value = approximator->feature_sum(indices.data(), values.data(), count);
+        double td_error = reward_value + discount * next_value - value;
+        *ssve = *ssve + td_error * td_error;
+
+        // Dutch trace: z = decay * z + (1 - step_size * decay * z'x) x
+        double trace_feature = decay * trace.dot(indices.data(), values.data(), count);
+        trace.scale(decay);
+        trace.add(indices.data(), values.data(), count,
+            1.0 - step_size * trace_feature);
+
+        // w += step_size * (td_error + value - old_value) z - step_size * (value - old_value) x
+        approximator->add_to_features(trace.index_data(), trace.value_data(),
+            trace.size(), step_size * (td_error + value - old_value));
+        approximator->add_to_features(indices.data(), values.data(), count,
+            -step_size * (value - old_value));
+        trace.prune(trace_threshold);
+
+        if (terminal) {
+            // Start over, the trace does not cross episode boundaries
+            environment->reset(state);
+            action = policy->apply(state, random);
+            count = approximator->features(state, action, indices.data(), values.data());
+            old_value = 0.0;
+            trace.clear();
+        } else {
+            state.swap(next_state);
+            action = next_action;
+            count = next_count;
+            indices.swap(next_indices);
+            values.swap(next_values);
+            old_value = next_value;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef __TRUE_ONLINE_SARSA_H_
+#define __TRUE_ONLINE_SARSA_H_
+
+#include <memory>
+#include "src/learner/learner.h"
+#include "src/learner/sparse_trace.h"
+#include "src/policy/policy.h"
+
+/**
+ * @brief Implementation of true online SARSA(lambda) with a dutch eligibility
+ *        trace over the sparse features of the approximator (e.g. the active
+ *        tiles of a tile coding). Trace entries below a threshold are dropped,
+ *        so a step costs the active features times the steps a trace entry
+ *        survives, independent of any n-step window.
+ */
+class TrueOnlineSarsa : public Learner {
+  public:
+    const double discount;                //<! Discount factor
+    const std::shared_ptr<Policy> policy; //<! Policy to learn
+    const double lambda;                  //<! Trace decay parameter
+    const double trace_threshold;         //<! Smallest trace value which is kept
+
+   /**
+   * @brief Constructor for the true online SARSA(lambda) algorithm
+   * @param discount The discount factor gamma
+   * @param policy The policy that is used in the algorithm
+   * @param approximator The approximator that estimates the value function, must provide sparse features
+   * @param reward The reward function to be used
+   * @param environment_generator Function which generates environment to use
+   * @param lambda Trace decay parameter, 0 is one-step SARSA and 1 approaches Monte Carlo
+   * @param trace_threshold Trace values with smaller magnitude are dropped
+   */
+    explicit TrueOnlineSarsa(
+        double const& discount,
+        std::shared_ptr<Policy> const& policy,
+        std::shared_ptr<Approximator> const& approximator,
+        reward_function const& reward,
+        environment_function const& environment_generator,
+        double lambda = 0.9,
+        double trace_threshold = 1e-3);
+
+    std::shared_ptr<Policy> get_policy() override;
+
+  protected:
+    void learn_episode(
+        int max_steps,
+        double* ssve_out,
+        double* total_reward_out,
+        Environment* environment,
+        CounterRng& random,
+        uint64_t episode) override;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "src/policy/epsilon_greedy.h"
+#include <algorithm>
 #include <utility>
 
 EpsilonGreedy::EpsilonGreedy(
@@ -9,21 +10,22 @@ EpsilonGreedy::EpsilonGreedy(
     distribution_real(0, 1),
     distribution_int(0, approximator->number_of_actions-1),
     epsilon(epsilon) {
-        actions = Eigen::VectorXi::LinSpaced(
-            approximator->number_of_actions,
-            0, approximator->number_of_actions-1);
 }
 
 int EpsilonGreedy::apply(
     const Eigen::Ref<const Eigen::VectorXd>& state) {
     if (distribution_real(random_generator) < 1.0 - epsilon) {
-        auto q_values = approximator->predict(state, actions);
-        int index = 0;
-        for (int i = 1; i < q_values.size(); i++) {
-            if (q_values[i] > q_values[index]) index = i;
-        }
-        // q_values.maxCoeff(&index);
-        return index;
+        return approximator->greedy_action(state);
     }
     return distribution_int(random_generator);
+}
+
+int EpsilonGreedy::apply(
+    const Eigen::Ref<const Eigen::VectorXd>& state,
+    CounterRng& random) {
+    if (random.uniform() < 1.0 - epsilon) {
+        return approximator->greedy_action(state);
+    }
+    const int actions = approximator->number_of_actions;
+    return std::min(int(random.uniform() * actions), actions - 1);
 }
\ No newline at end of file
@@ -5,15 +5,16 @@
 #include <random>
 
 /**
- * @brief Implements an epsilon greedy policy.
+ * @brief Implements an epsilon greedy policy. Learners pass the generator
+ *        of their episode, the shared generator only serves callers without
+ *        one (e.g. rendering) and is not thread-safe.
  * 
  */
 class EpsilonGreedy : public Policy {
-  private:
+  protected:
     std::mt19937 random_generator;                      //<! random number generator
     std::uniform_real_distribution<> distribution_real; //<! distribution for greediness
     std::uniform_int_distribution<> distribution_int;   //<! distribution for random action
-    Eigen::VectorXi actions;                            //<! Holds all possible action values
   
   public:
     double epsilon; //<! Percentage of randomly taken actions
@@ -30,6 +31,10 @@ class EpsilonGreedy : public Policy {
     
     int apply(
         const Eigen::Ref<const Eigen::VectorXd>& state) override;
+
+    int apply(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        CounterRng& random) override;
 };
 
 #endif
\ No newline at end of file
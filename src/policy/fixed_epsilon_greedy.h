@@ -0,0 +1,77 @@
+#ifndef __FIXED_EPSILON_GREEDY_H_
+#define __FIXED_EPSILON_GREEDY_H_
+
+#include "src/policy/epsilon_greedy.h"
+#include <algorithm>
+#include <memory>
+
+/**
+ * @brief Epsilon greedy policy which calls the non-virtual greedy method of a
+ *        fixed-size approximator (e.g. FixedTileCoding) directly.
+ *
+ * @tparam FixedApproximator Approximator type with a greedy(const double*) method
+ */
+template <class FixedApproximator>
+class FixedEpsilonGreedy final : public EpsilonGreedy {
+  private:
+    FixedApproximator* fixed_approximator; //<! Typed view of the approximator
+
+  public:
+    /**
+     * @brief Construct a new fixed Epsilon Greedy policy
+     *
+     * @param epsilon Percentage of randomly taken actions
+     * @param approximator Approximater which provides state-action values
+     */
+    FixedEpsilonGreedy(
+        double epsilon,
+        const std::shared_ptr<FixedApproximator>& approximator)
+        : EpsilonGreedy(epsilon, approximator),
+        fixed_approximator(approximator.get()) {}
+
+    int apply(
+        const Eigen::Ref<const Eigen::VectorXd>& state) override {
+        if (state.size() != fixed_approximator->dimensions_of_statespace)
+            throw std::invalid_argument("State vector has wrong size.");
+        return select(state.data());
+    }
+
+    int apply(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        CounterRng& random) override {
+        if (state.size() != fixed_approximator->dimensions_of_statespace)
+            throw std::invalid_argument("State vector has wrong size.");
+        return select(state.data(), random);
+    }
+
+    /**
+     * @brief Selects an action without validation and without virtual calls.
+     *
+     * @param state State vector with the approximator's state size
+     * @return int
+     */
+    int select(const double* state) {
+        if (distribution_real(random_generator) < 1.0 - epsilon) {
+            return fixed_approximator->greedy(state);
+        }
+        return distribution_int(random_generator);
+    }
+
+    /**
+     * @brief Selects an action without validation and without virtual calls,
+     *        random decisions draw from the given generator.
+     *
+     * @param state State vector with the approximator's state size
+     * @param random Random number generator of the episode
+     * @return int
+     */
+    int select(const double* state, CounterRng& random) {
+        if (random.uniform() < 1.0 - epsilon) {
+            return fixed_approximator->greedy(state);
+        }
+        const int actions = fixed_approximator->number_of_actions;
+        return std::min(int(random.uniform() * actions), actions - 1);
+    }
+};
+
+#endif
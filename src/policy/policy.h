@@ -2,6 +2,7 @@
 #define __POLICY_H_
 
 #include "src/approximator/approximator.h"
+#include "src/environment/counter_rng.h"
 #include <memory>
 #include <utility>
 
@@ -31,6 +32,21 @@ class Policy {
      */
     virtual int apply(
         const Eigen::Ref<const Eigen::VectorXd>& state) = 0;
+
+    /**
+     * @brief Return an action value based on the given state vector, random
+     *        decisions draw from the generator of the calling thread.
+     *        Deterministic policies ignore the generator.
+     * 
+     * @param state State vector
+     * @param random Random number generator of the episode
+     * @return int 
+     */
+    virtual int apply(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        CounterRng& random) {
+        return apply(state);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "src/render/frame_renderer.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+FrameRenderer::FrameRenderer(const std::string& directory, Format format)
+    : directory(directory), format(format), frames(0), width(0), height(0) {
+    if (format == Format::RAW) {
+        raw.open(directory + "/frames.raw", std::ios_base::binary | std::ios_base::trunc);
+        if (!raw)
+            throw std::runtime_error("Cannot write frames to " + directory);
+    }
+}
+
+void FrameRenderer::draw(const Scene& scene) {
+    if (scene.width <= 0 || scene.height <= 0)
+        throw std::invalid_argument("Scene has no pixels.");
+    // Raw frames have no header, all of them need the same size
+    if (format == Format::RAW && frames > 0
+        && (scene.width != width || scene.height != height))
+        throw std::invalid_argument("Scene size changed between raw frames.");
+    width = scene.width;
+    height = scene.height;
+    pixels.assign(std::size_t(width) * height * 3, 0);
+
+    for (const SceneRectangle& rectangle : scene.rectangles) {
+        // Parts outside of the frame are clipped
+        const int left = std::max(rectangle.x, 0);
+        const int top = std::max(rectangle.y, 0);
+        const int right = std::min(rectangle.x + rectangle.width, width);
+        const int bottom = std::min(rectangle.y + rectangle.height, height);
+        for (int y=top; y < bottom; y++) {
+            uint8_t* pixel = pixels.data() + (std::size_t(y) * width + left) * 3;
+            for (int x=left; x < right; x++, pixel += 3) {
+                pixel[0] = rectangle.red;
+                pixel[1] = rectangle.green;
+                pixel[2] = rectangle.blue;
+            }
+        }
+    }
+
+    if (format == Format::RAW) {
+        raw.write(reinterpret_cast<const char*>(pixels.data()), int64_t(pixels.size()));
+        if (!raw)
+            throw std::runtime_error("Cannot write frames to " + directory);
+    } else {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame_%06d.ppm", frames);
+        std::ofstream image(directory + name, std::ios_base::binary | std::ios_base::trunc);
+        image << "P6\n" << width << " " << height << "\n255\n";
+        image.write(reinterpret_cast<const char*>(pixels.data()), int64_t(pixels.size()));
+        if (!image)
+            throw std::runtime_error("Cannot write frame " + directory + name);
+    }
+    frames++;
+}
+
+int FrameRenderer::record(FlappySimulator& environment, std::shared_ptr<Policy> policy, int frames) {
+    Eigen::VectorXd observation = Eigen::VectorXd::Zero(environment.getStateDim());
+    environment.reset(observation);
+    int episodes = 0;
+    for (int frame=0; frame < frames; frame++) {
+        draw(environment.getScene());
+        bool episode_over = false;
+        environment.step(policy->apply(observation), observation, episode_over);
+        if (episode_over) {
+            environment.reset(observation);
+            episodes++;
+        }
+    }
+    if (format == Format::RAW) raw.flush();
+    return episodes;
+}
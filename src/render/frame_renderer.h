@@ -0,0 +1,71 @@
+#ifndef __FRAME_RENDERER_H_
+#define __FRAME_RENDERER_H_
+
+#include "src/environment/flappy_simulator.h"
+#include "src/policy/policy.h"
+#include "src/render/scene.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Offscreen renderer which rasterizes scenes into memory and writes
+ *        every frame to disk, as numbered PPM images or appended to one raw
+ *        RGB24 file. Needs no display, frames are written as fast as the
+ *        simulation runs.
+ */
+class FrameRenderer : public Renderer {
+  public:
+    enum class Format {
+        PPM, //<! One binary PPM (P6) image per frame, frame_000000.ppm, ...
+        RAW  //<! All frames as packed RGB24 in frames.raw
+    };
+
+    /**
+     * @brief Construct a new frame renderer
+     *
+     * @param directory Output directory, must exist
+     * @param format Output format
+     */
+    FrameRenderer(const std::string& directory, Format format = Format::PPM);
+
+    void draw(const Scene& scene) override;
+
+    /**
+     * @brief Plays with a policy and writes one frame per step, starting
+     *        with the first state. Finished episodes are reset.
+     *
+     * @param environment Environment to play
+     * @param policy Policy which selects the actions
+     * @param frames Number of frames to write
+     * @return Number of finished episodes
+     */
+    int record(FlappySimulator& environment, std::shared_ptr<Policy> policy, int frames);
+
+    /**
+     * @brief Get the number of written frames
+     *
+     * @return int
+     */
+    int getFrames() const { return frames; }
+
+    /**
+     * @brief Get the pixels of the last frame, RGB24 row by row
+     *
+     * @return const std::vector<uint8_t>&
+     */
+    const std::vector<uint8_t>& getPixels() const { return pixels; }
+
+  private:
+    std::string directory;      //<! Output directory
+    Format format;              //<! Output format
+    int frames;                 //<! Number of written frames
+    int width;                  //<! Width of the frames
+    int height;                 //<! Height of the frames
+    std::vector<uint8_t> pixels; //<! Last frame, RGB24 row by row
+    std::ofstream raw;          //<! Output file of the raw format
+};
+
+#endif
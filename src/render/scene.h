@@ -0,0 +1,46 @@
+#ifndef __SCENE_H_
+#define __SCENE_H_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Filled rectangle in pixel coordinates, the origin is the upper
+ *        left corner
+ */
+struct SceneRectangle {
+    int x;         //<! Left edge
+    int y;         //<! Upper edge
+    int width;     //<! Width in pixels
+    int height;    //<! Height in pixels
+    uint8_t red;   //<! Red channel
+    uint8_t green; //<! Green channel
+    uint8_t blue;  //<! Blue channel
+};
+
+/**
+ * @brief Description of one frame, independent of the output device.
+ *        Rectangles are drawn in order on a black background.
+ */
+struct Scene {
+    int width;                               //<! Width of the frame in pixels
+    int height;                              //<! Height of the frame in pixels
+    std::vector<SceneRectangle> rectangles;  //<! Shapes of the frame
+};
+
+/**
+ * @brief Base class for output devices of scenes
+ */
+class Renderer {
+  public:
+    virtual ~Renderer() {}
+
+    /**
+     * @brief Draws one frame
+     *
+     * @param scene Frame to draw
+     */
+    virtual void draw(const Scene& scene) = 0;
+};
+
+#endif
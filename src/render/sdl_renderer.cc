@@ -0,0 +1,117 @@
+#include "src/render/sdl_renderer.h"
+#include <chrono>
+#include <iostream>
+
+SdlRenderer::SdlRenderer(int width, int height, const std::string& title) {
+    SDL_Init(SDL_INIT_VIDEO);
+    window = SDL_CreateWindow(
+        title.c_str(),
+        SDL_WINDOWPOS_UNDEFINED,
+        SDL_WINDOWPOS_UNDEFINED,
+        width,
+        height,
+        0
+    );
+
+    if (!window) {
+        std::cout << "Failed to create window" << std::endl
+                  << "SDL Error: " << SDL_GetError() << std::endl;
+        window_surface = nullptr;
+        return;
+    }
+
+    window_surface = SDL_GetWindowSurface(window);
+
+    if (!window_surface) {
+        std::cout << "Failed to get window's surface" << std::endl
+                  << "SDL Error: " << SDL_GetError() << std::endl;
+    }
+}
+
+SdlRenderer::~SdlRenderer() {
+    if (window) {
+        SDL_FreeSurface(window_surface);
+        SDL_DestroyWindow(window);
+    }
+    SDL_Quit();
+}
+
+void SdlRenderer::draw(const Scene& scene) {
+    if (!window_surface) return;
+    // Clean
+    SDL_FillRect(window_surface, NULL, SDL_MapRGB(window_surface->format, 0, 0, 0));
+
+    // Game scene
+    for (const SceneRectangle& rectangle : scene.rectangles) {
+        SDL_Rect position;
+        position.x = rectangle.x;
+        position.y = rectangle.y;
+        position.w = rectangle.width;
+        position.h = rectangle.height;
+        SDL_FillRect(window_surface, &position, SDL_MapRGB(window_surface->format,
+            rectangle.red, rectangle.green, rectangle.blue));
+    }
+
+    // Draw
+    SDL_UpdateWindowSurface(window);
+}
+
+void SdlRenderer::play(FlappySimulator& environment, std::shared_ptr<Policy> policy,
+        double play_time_sec, double speedup) {
+    if (!window_surface) {
+        std::cout << "Can only play with a window" << std::endl;
+        return;
+    }
+
+    Eigen::VectorXd obs = Eigen::VectorXd::Zero(environment.getStateDim());
+    environment.reset(obs);
+
+    const double dt = FlappySimulator::dt;
+    auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
+    auto start_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    auto frame_ms = start_ms - dt * 1000.0 / speedup;
+
+    // Stores selected action (can be overwriten by keyboard)
+    int selected_action = -1;
+
+    bool keep_running = true;
+    while(keep_running) {
+        // SDL Event handling
+        SDL_Event e;
+        while (SDL_PollEvent(&e) > 0) {
+            switch(e.type) {
+                case SDL_QUIT:
+                    keep_running = false;
+                    break;
+            }
+        }
+
+        // Holding shift overwrites action (Space is flap action)
+        unsigned char const *keys = SDL_GetKeyboardState(nullptr);
+        if (keys[SDL_SCANCODE_LSHIFT]) {
+            selected_action = keys[SDL_SCANCODE_SPACE] ? 1:0;
+        }
+
+        // Get current time
+        now = std::chrono::high_resolution_clock::now().time_since_epoch();
+        auto current_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+
+        // Check if next frame to draw
+        if (current_ms - frame_ms >= dt * 1000.0 / speedup) {
+            bool episode_over = false;
+            // Choose policy action if no keyboard input
+            if (selected_action < 0) selected_action = policy->apply(obs);
+            // Perform step and render
+            environment.step(selected_action, obs, episode_over);
+            draw(environment.getScene());
+            // Check if episode over
+            if (episode_over) environment.reset(obs);
+            // Reset frame timer and action
+            frame_ms = current_ms;
+            selected_action = -1;
+        }
+
+        // Check if timeout
+        keep_running &= (current_ms - start_ms < play_time_sec*1000.0);
+    }
+}
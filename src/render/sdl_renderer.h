@@ -0,0 +1,47 @@
+#ifndef __SDL_RENDERER_H_
+#define __SDL_RENDERER_H_
+
+#include "src/environment/flappy_simulator.h"
+#include "src/policy/policy.h"
+#include "src/render/scene.h"
+#include "SDL.h"
+#include <memory>
+#include <string>
+
+/**
+ * @brief Draws scenes into an SDL window. This is the only part of the
+ *        project which depends on SDL, it is built with RLAGENT_WITH_SDL.
+ */
+class SdlRenderer : public Renderer {
+  private:
+    SDL_Window* window;
+    SDL_Surface* window_surface;
+
+  public:
+    /**
+     * @brief Opens a window
+     *
+     * @param width Width of the window in pixels
+     * @param height Height of the window in pixels
+     * @param title Title of the window
+     */
+    SdlRenderer(int width, int height, const std::string& title = "Flappy Simulator");
+
+    ~SdlRenderer();
+
+    void draw(const Scene& scene) override;
+
+    /**
+     * @brief Plays in real time with a policy. Holding shift overwrites the
+     *        action of the policy, space flaps.
+     *
+     * @param environment Environment to play
+     * @param policy Policy which selects the actions
+     * @param play_time_sec Duration in seconds
+     * @param speedup Factor of the simulation speed
+     */
+    void play(FlappySimulator& environment, std::shared_ptr<Policy> policy,
+        double play_time_sec = 10.0, double speedup = 1.0);
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "src/approximator/hashed_tile_coding.h"
+
+/*
+ * Checks of the hashed tile coding: tiles get their own slots by linear
+ * probing until the table is full, predictions do not insert tiles and a
+ * saved table loads with the same slots, values and counters.
+ */
+
+namespace {
+const int CAPACITY = 8;  // Tile slots, fewer than HashedTileCoding::MAX_PROBES
+const int SEGMENTS = 32; // Tiles of the state space, one per integer state
+
+/**
+ * @brief One tiling over [0, SEGMENTS) with one tile per integer state, so
+ *        one update with step size 1 sets the value of a tile to the target.
+ */
+std::unique_ptr<HashedTileCoding> make_approximator(std::size_t capacity = CAPACITY) {
+    return std::make_unique<HashedTileCoding>(
+        2, 1, 1.0, 1, capacity,
+        (Eigen::Matrix<int, 1, 1>() << 1).finished(),
+        (Eigen::Matrix<int, 1, 1>() << SEGMENTS).finished(),
+        (Eigen::Matrix<float, 1, 1>() << 0).finished(),
+        (Eigen::Matrix<float, 1, 1>() << SEGMENTS).finished());
+}
+
+Eigen::VectorXd state(int tile) {
+    return Eigen::VectorXd::Constant(1, tile + 0.5);
+}
+
+double value(HashedTileCoding& approximator, int tile, int action) {
+    Eigen::VectorXd values(2);
+    approximator.predict_all(state(tile), values);
+    return values[action];
+}
+
+int failures = 0;
+
+void check(bool condition, const char* message) {
+    if (condition) return;
+    failures++;
+    std::printf("FAILED: %s\n", message);
+}
+
+/**
+ * @brief Fills the table and overflows it.
+ */
+void test_probing_and_overflow() {
+    auto approximator = make_approximator();
+
+    // Predictions of unknown tiles read the initial values and claim nothing
+    check(value(*approximator, 1, 1) == 0.0, "unknown tile has a value");
+    check(approximator->greedy_action(state(2)) == 0, "unknown tile has a greedy action");
+    check(approximator->getOccupancy() == 0, "prediction inserted a tile");
+
+    // Every tile claims its own slot until the table is full
+    for (int tile = 0; tile < CAPACITY; tile++)
+        approximator->update(state(tile), 1, tile + 1.0);
+    check(approximator->getOccupancy() == CAPACITY, "tiles share slots in a free table");
+    check(approximator->getCollisions() == 0, "collision in a free table");
+    bool own_values = true;
+    for (int tile = 0; tile < CAPACITY; tile++) {
+        own_values = own_values && value(*approximator, tile, 1) == tile + 1.0
+            && value(*approximator, tile, 0) == 0.0;
+    }
+    check(own_values, "tile does not have its own value");
+
+    // A full table shares slots, only updates count collisions
+    value(*approximator, CAPACITY, 1);
+    check(approximator->getCollisions() == 0, "prediction counted a collision");
+    approximator->update(state(CAPACITY), 0, 1.0);
+    approximator->update(state(CAPACITY + 1), 0, 1.0);
+    check(approximator->getOccupancy() == CAPACITY, "occupancy exceeds the capacity");
+    check(approximator->getCollisions() == 2, "collisions of a full table not counted");
+}
+
+/**
+ * @brief Saves a table and loads it into a new one.
+ */
+void test_save_load() {
+    const std::string filename = "hashed_tile_coding_test.bin";
+    auto saved = make_approximator();
+    for (int tile = 0; tile < SEGMENTS; tile += 3)
+        saved->update(state(tile), tile % 2, tile - 10.0);
+    saved->save(filename);
+
+    auto loaded = make_approximator();
+    loaded->load(filename);
+    check(loaded->getOccupancy() == saved->getOccupancy(), "occupancy differs after load");
+    check(loaded->getCollisions() == saved->getCollisions(), "collisions differ after load");
+    bool same_values = true;
+    for (int tile = 0; tile < SEGMENTS; tile++) {
+        for (int action = 0; action < 2; action++) {
+            same_values = same_values && value(*loaded, tile, action)
+                == value(*saved, tile, action);
+        }
+    }
+    check(same_values, "values differ after load");
+
+    // Known tiles keep their slots, updates change only their own value
+    loaded->update(state(3), 1, 5.0);
+    check(value(*loaded, 3, 1) == 5.0, "loaded tile lost its slot");
+    check(loaded->getOccupancy() == saved->getOccupancy(), "loaded tile inserted again");
+
+    auto other = make_approximator(CAPACITY * 2);
+    bool rejected = false;
+    try {
+        other->load(filename);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    check(rejected, "file of another memory size loaded");
+    std::remove(filename.c_str());
+}
+}
+
+int main() {
+    test_probing_and_overflow();
+    test_save_load();
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
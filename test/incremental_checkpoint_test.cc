@@ -0,0 +1,113 @@
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/approximator/incremental_checkpoint.h"
+#include "src/approximator/tile_coding.h"
+
+/*
+ * Checks of the incremental checkpoint: a base with deltas restores the last
+ * saved weights, and a delta file truncated within a delta restores the
+ * weights of the last complete delta, never a mix of two checkpoints.
+ */
+
+namespace {
+const std::string FILENAME = "incremental_checkpoint_test.dat";
+const int DELTAS = 3; // Deltas written after the base
+
+/**
+ * @brief Tile coding with weights in several blocks of change tracking.
+ */
+std::shared_ptr<TileCoding> make_approximator() {
+    return std::make_shared<TileCoding>(
+        2, 2, 0.1, 4,
+        (Eigen::Matrix<int, 2, 1>() << 1, 3).finished(),
+        (Eigen::Matrix<int, 2, 1>() << 50, 50).finished(),
+        (Eigen::Matrix<float, 2, 1>() << 0, 0).finished(),
+        (Eigen::Matrix<float, 2, 1>() << 1, 1).finished());
+}
+
+std::vector<float> weights_of(Approximator& approximator) {
+    WeightTable* weights = approximator.weight_table();
+    return std::vector<float>(weights->data(), weights->data() + weights->size());
+}
+
+/**
+ * @brief Loads the base, applies the deltas and returns the weights.
+ */
+std::vector<float> restored_weights() {
+    auto approximator = make_approximator();
+    approximator->load(FILENAME);
+    IncrementalCheckpoint::restore(*approximator, FILENAME);
+    return weights_of(*approximator);
+}
+
+int failures = 0;
+
+void check(bool condition, const char* message) {
+    if (condition) return;
+    failures++;
+    std::printf("FAILED: %s\n", message);
+}
+
+/**
+ * @brief Writes a base and deltas, then restores the complete and truncated
+ *        delta files.
+ */
+void test_truncated_delta() {
+    const std::string delta_file = FILENAME + ".delta";
+    auto approximator = make_approximator();
+    // Weights and size of the delta file after each delta
+    std::vector<std::vector<float>> saved;
+    std::vector<std::uintmax_t> delta_sizes;
+    {
+        IncrementalCheckpoint checkpoint(approximator, FILENAME, DELTAS + 1);
+        checkpoint.wait();
+        saved.push_back(weights_of(*approximator));
+        delta_sizes.push_back(std::filesystem::file_size(delta_file));
+        Eigen::VectorXd state(2);
+        for (int delta = 1; delta <= DELTAS; delta++) {
+            // Updates all over the state space change many blocks
+            for (int i = 0; i < 500; i++) {
+                state << (i % 23) / 23.0, (i % 19) / 19.0;
+                approximator->update(state, i % 2, delta + 0.1 * i);
+            }
+            checkpoint.save();
+            checkpoint.wait();
+            saved.push_back(weights_of(*approximator));
+            delta_sizes.push_back(std::filesystem::file_size(delta_file));
+        }
+    }
+    check(restored_weights() == saved[DELTAS], "complete deltas restore other weights");
+
+    // Cut the last delta at its end, in its middle and in its header. The
+    // file only shrinks, growing it would append zeros.
+    const std::uintmax_t first = delta_sizes[DELTAS - 1];
+    const std::uintmax_t last = delta_sizes[DELTAS];
+    for (std::uintmax_t size : {last - 1, first + (last - first) / 2, first + 4}) {
+        std::filesystem::resize_file(delta_file, size);
+        check(restored_weights() == saved[DELTAS - 1],
+            "truncated delta does not restore the previous delta");
+    }
+    std::filesystem::resize_file(delta_file, first);
+    check(restored_weights() == saved[DELTAS - 1], "deltas before the cut are lost");
+    std::filesystem::resize_file(delta_file, delta_sizes[0]);
+    check(restored_weights() == saved[0], "empty delta file does not restore the base");
+
+    std::filesystem::remove(FILENAME);
+    std::filesystem::remove(delta_file);
+}
+}
+
+int main() {
+    test_truncated_delta();
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "src/approximator/tile_coding.h"
+#include "src/environment/flappy_simulator.h"
+#include "src/learner/sarsa.h"
+#include "src/policy/epsilon_greedy.h"
+
+/*
+ * Checks of the n-step Sarsa step loop: the rolling n-step return matches the
+ * former loop, which summed the window with std::pow every step, and the loop
+ * does not allocate once the buffers of the thread are sized.
+ */
+
+#if defined(__GNUC__) && !defined(__clang__)
+// The replaced operators below pair operator new with free on purpose
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+std::atomic<bool> counting(false);          // Allocations are only counted while set
+std::atomic<uint64_t> new_calls(0);         // Calls of operator new
+std::atomic<uint64_t> malloc_calls(0);      // Calls of malloc, e.g. by Eigen
+}
+
+void* operator new(std::size_t size) {
+    if (counting) new_calls++;
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (counting) new_calls++;
+    std::size_t align = static_cast<std::size_t>(alignment);
+    void* memory = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+#ifdef __GLIBC__
+// Eigen allocates with malloc, not with operator new
+extern "C" void* __libc_malloc(std::size_t size);
+
+extern "C" void* malloc(std::size_t size) {
+    if (counting) malloc_calls++;
+    return __libc_malloc(size);
+}
+#endif
+
+namespace {
+/**
+ * @brief Environment whose state is the step within the episode, ends after
+ *        a fixed number of steps (never if 0).
+ */
+class CountingEnvironment : public Environment {
+  public:
+    int terminal_step;
+    int time = 0;
+
+    explicit CountingEnvironment(int terminal_step) : terminal_step(terminal_step) {}
+
+    int getNumberOfActions() override { return 2; }
+
+    int getStateDim() override { return 1; }
+
+    Eigen::VectorXd getState() override { return Eigen::VectorXd::Constant(1, time); }
+
+    void step(int action, Eigen::Ref<Eigen::VectorXd> observation, bool& done) override {
+        time++;
+        observation[0] = time;
+        done = terminal_step > 0 && time == terminal_step;
+    }
+
+    void reset(Eigen::Ref<Eigen::VectorXd> observation) override {
+        time = 0;
+        observation[0] = time;
+    }
+
+    void render(std::string mode) override {}
+};
+
+/**
+ * @brief Approximator with fixed values that records the update targets.
+ */
+class RecordingApproximator : public Approximator {
+  public:
+    std::vector<double> targets;
+
+    RecordingApproximator() : Approximator(2, 1) {}
+
+    void save(std::string filename) override {}
+
+    void load(std::string filename) override {}
+
+  protected:
+    double predict_implementation(
+        Eigen::Ref<const Eigen::VectorXd> state, int action) override {
+        return std::cos(0.7 * state[0]) + 0.25 * action;
+    }
+
+    double update_implementation(
+        const Eigen::Ref<const Eigen::VectorXd>& state,
+        int action,
+        double target) override {
+        targets.push_back(target);
+        return target - predict_implementation(state, action);
+    }
+};
+
+/**
+ * @brief Deterministic policy, alternates the action with the state.
+ */
+class ParityPolicy : public Policy {
+  public:
+    explicit ParityPolicy(const std::shared_ptr<Approximator>& approximator)
+        : Policy(approximator) {}
+
+    using Policy::apply;
+
+    int apply(const Eigen::Ref<const Eigen::VectorXd>& state) override {
+        return int(state[0]) % 3 == 0 ? 1 : 0;
+    }
+};
+
+double test_reward(const Eigen::Ref<const Eigen::VectorXd>& state, int action,
+        const Eigen::Ref<const Eigen::VectorXd>& next_state, Environment* environment) {
+    return std::sin(1.3 * state[0]) + action - 0.5;
+}
+
+/**
+ * @brief Sarsa with its episode exposed.
+ */
+class TestSarsa : public Sarsa {
+  public:
+    using Sarsa::Sarsa;
+    using Sarsa::learn_episode;
+};
+
+/**
+ * @brief The n-step Sarsa loop before the rolling return, the window was
+ *        summed with std::pow in every step.
+ */
+class ReferenceSarsa : public Learner {
+  public:
+    const double discount;
+    const std::shared_ptr<Policy> policy;
+    const int n_steps;
+
+    ReferenceSarsa(double discount, std::shared_ptr<Policy> policy,
+            std::shared_ptr<Approximator> approximator, int n_steps)
+        : Learner(approximator, test_reward, nullptr),
+          discount(discount), policy(policy), n_steps(n_steps) {}
+
+    void learn_episode(
+            int max_steps,
+            double* ssve,
+            double* total_reward,
+            Environment* environment,
+            CounterRng& random,
+            uint64_t episode) override {
+        Eigen::MatrixXd n_step_states = Eigen::MatrixXd::Zero(
+            environment->getStateDim(), n_steps);
+        std::vector<double> n_step_rewards(n_steps);
+        std::vector<int> n_step_actions(n_steps);
+        Eigen::VectorXd future_values(approximator->number_of_actions);
+        Eigen::VectorXd state = Eigen::VectorXd::Zero(environment->getStateDim());
+        environment->reset(state);
+        int action = policy->apply(state);
+        int step = 0;
+        int tau = 0;
+        *ssve = 0;
+        *total_reward = 0;
+        int remaining_steps = max_steps;
+        n_step_states.col(step % n_steps) = state;
+        n_step_actions[step % n_steps] = action;
+        while(remaining_steps > 0) {
+            do {
+                if (step < max_steps) {
+                    bool terminal = false;
+                    Eigen::VectorXd next_state = Eigen::VectorXd::Zero(state.size());
+                    environment->step(action, next_state, terminal);
+                    double reward_value = reward(state, action, next_state, environment);
+                    *total_reward = *total_reward + reward_value;
+                    n_step_rewards[(step+1) % n_steps] = reward_value;
+                    n_step_states.col((step+1) % n_steps) = next_state;
+                    state = next_state;
+                    action = policy->apply(state);
+                    if (terminal) {
+                        environment->reset(state);
+                        action = policy->apply(state);
+                        max_steps = step + 1;
+                    }
+                    else {
+                        n_step_actions[(step+1) % n_steps] = action;
+                    }
+                }
+
+                tau = step - n_steps + 1;
+                if (tau >= 0) {
+                    double reward_sum = 0.0;
+                    for (int i=tau+1; i <= std::min(max_steps, step + 1); i++) {
+                        double future_reward = n_step_rewards[i % n_steps];
+                        double dampening = std::pow(discount, i-tau-1);
+                        reward_sum = reward_sum + dampening*future_reward;
+                    }
+                    int future_time = tau + n_steps;
+                    if (future_time < max_steps) {
+                        int future_action = n_step_actions[future_time % n_steps];
+                        approximator->predict_all(
+                            n_step_states.col(future_time % n_steps), future_values);
+                        reward_sum = reward_sum
+                            + std::pow(discount, n_steps)*future_values[future_action];
+                    }
+                    double td_error = approximator->update(
+                        n_step_states.col(tau % n_steps),
+                        n_step_actions[tau % n_steps],
+                        reward_sum);
+                    *ssve = *ssve + std::pow(td_error, 2.0);
+                }
+
+                step = step + 1;
+            } while(tau != max_steps - 1);
+
+            remaining_steps -= max_steps;
+            max_steps = remaining_steps;
+            step = 0;
+        }
+    }
+};
+
+int failures = 0;
+
+void check(bool condition, const char* message, int n_steps, int terminal_step) {
+    if (condition) return;
+    failures++;
+    std::printf("FAILED: %s (n = %d, terminal step = %d)\n", message, n_steps, terminal_step);
+}
+
+/**
+ * @brief Compares the update targets of Sarsa and the former loop.
+ */
+void test_n_step_return() {
+    const int max_steps = 60;
+    const double discount = 0.9;
+    for (int n_steps = 1; n_steps <= 20; n_steps++) {
+        // Truncated (0) and terminal episodes around the window size
+        for (int terminal_step : {0, 1, 7, n_steps - 1, n_steps, n_steps + 1, 2 * n_steps + 3, max_steps - 1}) {
+            auto expected = std::make_shared<RecordingApproximator>();
+            auto actual = std::make_shared<RecordingApproximator>();
+            ReferenceSarsa reference(discount,
+                std::make_shared<ParityPolicy>(expected), expected, n_steps);
+            TestSarsa sarsa(discount, std::make_shared<ParityPolicy>(actual), actual,
+                test_reward, nullptr, n_steps);
+            CountingEnvironment reference_environment(terminal_step);
+            CountingEnvironment environment(terminal_step);
+            double expected_ssve, expected_reward, ssve, total_reward;
+            CounterRng random;
+            reference.learn_episode(max_steps, &expected_ssve, &expected_reward,
+                &reference_environment, random, 0);
+            sarsa.learn_episode(max_steps, &ssve, &total_reward, &environment, random, 0);
+
+            check(actual->targets.size() == expected->targets.size(),
+                "number of updates differs", n_steps, terminal_step);
+            double error = 0.0;
+            for (std::size_t i = 0; i < std::min(actual->targets.size(), expected->targets.size()); i++) {
+                error = std::max(error, std::abs(actual->targets[i] - expected->targets[i])
+                    / (1.0 + std::abs(expected->targets[i])));
+            }
+            check(error < 1e-12, "n-step return differs", n_steps, terminal_step);
+            check(total_reward == expected_reward, "total reward differs", n_steps, terminal_step);
+            check(std::abs(ssve - expected_ssve) < 1e-9 * (1.0 + expected_ssve),
+                "square value error differs", n_steps, terminal_step);
+        }
+    }
+}
+
+/**
+ * @brief Counts the allocations of the Flappy Bird setup after a warm-up
+ *        episode, which sizes the buffers of the thread.
+ */
+void test_allocations() {
+    const int steps = 20000;
+    auto approximator = std::make_shared<TileCoding>(
+        int(FlappySimulator::NUMBER_OF_ACTIONS),
+        int(FlappySimulator::SIZE_OF_STATESPACE),
+        0.1, 5,
+        (Eigen::Matrix<int, 5, 1>() << 1, 3, 5, 7, 11).finished(),
+        (Eigen::Matrix<int, 5, 1>() << 10, 10, 10, 10, 10).finished(),
+        (Eigen::Matrix<float, 5, 1>() << 0, 3.75, 3.75, 1, -10).finished(),
+        (Eigen::Matrix<float, 5, 1>() << 11, 10.25, 10.25, 13, 10).finished());
+    auto policy = std::make_shared<EpsilonGreedy>(0.2, approximator);
+    Learner::reward_function reward = [](const Eigen::Ref<const Eigen::VectorXd>& x, int a,
+            const Eigen::Ref<const Eigen::VectorXd>& x_next, Environment* env) {
+        return ((FlappySimulator*)env)->getCollision() ? -100.0 : 1.0;
+    };
+    TestSarsa sarsa(0.9, policy, approximator, reward, nullptr, 20);
+    FlappySimulator environment;
+    environment.seed(1, 0);
+    CounterRng random(1, 0);
+    double ssve, total_reward;
+    sarsa.learn_episode(400, &ssve, &total_reward, &environment, random, 0);
+
+    counting = true;
+    sarsa.learn_episode(steps, &ssve, &total_reward, &environment, random, 1);
+    counting = false;
+    std::printf("allocations in %d steps: %llu operator new, %llu malloc\n", steps,
+        (unsigned long long)new_calls.load(), (unsigned long long)malloc_calls.load());
+    check(new_calls == 0, "operator new called in the step loop", 20, 0);
+    check(malloc_calls == 0, "malloc called in the step loop", 20, 0);
+}
+}
+
+int main() {
+    test_n_step_return();
+    test_allocations();
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}